@@ -0,0 +1,113 @@
+"""
+Aging after a quench: the two-time autocorrelation
+C(t, t_w) = (1/N^2) sum_i s_i(t_w) s_i(t), measured inside the native
+sweep loop for many waiting times at once.
+
+The lattice is stored bit-packed at every waiting time, and each
+scheduled measurement packs the current lattice once and takes its
+overlap with every reference by popcount, N^2 / 64 words per reference,
+which keeps per-sweep measurement affordable on large lattices.
+"""
+import ctypes
+import numpy as np
+from .core import native, run_quench, Observer, OBS_AGING
+from .bitpack import words
+
+class _Aging(ctypes.Structure):
+    _fields_ = [('waiting', ctypes.c_void_p),
+                ('nwaiting', ctypes.c_int),
+                ('stored', ctypes.c_int),
+                ('taken', ctypes.c_void_p),
+                ('schedule', ctypes.c_void_p),
+                ('nschedule', ctypes.c_int),
+                ('next', ctypes.c_int),
+                ('refs', ctypes.c_void_p),
+                ('current', ctypes.c_void_p),
+                ('table', ctypes.c_void_p)]
+
+_measure_aging = native('measure_aging', [ctypes.POINTER(_Aging), ctypes.c_void_p])
+
+class Aging:
+    def __init__(self, N, waiting, schedule):
+        """
+        In-kernel two-time correlation.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        waiting : array of int
+            Increasing waiting times t_w (sweeps since the quench) at which
+            the reference configurations are stored
+        schedule : array of int
+            Increasing sweeps t at which C(t, t_w) is measured for every
+            stored reference, e.g. np.arange(nsweeps + 1) for every sweep or
+            coarsening.log_schedule(nsweeps) for logarithmic spacing
+
+        Example usage:
+
+        aging = Aging(N=1024, waiting=[10, 100, 1000], schedule=log_schedule(100000, 200))
+        aging.quench(temperature=1.5)
+        for t_w in aging.waiting:
+            lag, C = aging.lag(t_w)
+        """
+        self.N = N
+        self.waiting = np.ascontiguousarray(waiting, dtype=np.int64)
+        self.schedule = np.ascontiguousarray(schedule, dtype=np.int64)
+        if np.any(np.diff(self.waiting) <= 0) or np.any(np.diff(self.schedule) <= 0):
+            raise ValueError("waiting times and schedule must be strictly increasing")
+        W = N * words(N)
+        self.taken = np.full(len(self.waiting), -1, dtype=np.int64)
+        self.refs = np.zeros((len(self.waiting), W), dtype=np.uint64)
+        self._current = np.zeros(W, dtype=np.uint64)
+        self.table = np.full((len(self.schedule), len(self.waiting)), np.nan)
+        self._data = _Aging(self.waiting.ctypes.data, len(self.waiting), 0, self.taken.ctypes.data,
+                            self.schedule.ctypes.data, len(self.schedule), 0, self.refs.ctypes.data,
+                            self._current.ctypes.data, self.table.ctypes.data)
+
+    @property
+    def sweeps(self):
+        """ The measurement sweeps t of the rows filled so far """
+        return self.schedule[:self._data.next]
+
+    @property
+    def correlation(self):
+        """ C(t, t_w), one row per measurement so far and one column per waiting time """
+        return self.table[:self._data.next]
+
+    def lag(self, t_w):
+        """ t - t_w and C(t, t_w) for the measurements at or after waiting time t_w """
+        k = int(np.searchsorted(self.waiting, t_w))
+        if k == len(self.waiting) or self.waiting[k] != t_w:
+            raise ValueError(f"{t_w} is not one of the waiting times")
+        C = self.correlation[:, k]
+        keep = np.isfinite(C)
+        return self.sweeps[keep] - t_w, C[keep]
+
+    def _bind(self, state):
+        if state.N != self.N:
+            raise ValueError("aging measurement and lattice sizes differ")
+
+    def observer(self, state):
+        self._bind(state)
+        return Observer(OBS_AGING, 1, ctypes.addressof(self._data))
+
+    def reset(self):
+        """ Forget the stored references and the rows measured so far """
+        self._data.stored = 0
+        self._data.next = 0
+        self.taken.fill(-1)
+        self.table.fill(np.nan)
+
+    def record(self, state):
+        """ Store a reference and/or measure now if the state's sweep count is due """
+        self._bind(state)
+        _measure_aging(self._data, ctypes.addressof(state))
+
+    def quench(self, temperature, nsweeps=None, config=None, seed=None):
+        """
+        Quench from infinite temperature (or from config) to the given
+        temperature and run up to the last scheduled sweep.
+        """
+        self.config, self.state = run_quench(self, temperature, nsweeps, config, seed)
+        return self
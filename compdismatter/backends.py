@@ -0,0 +1,159 @@
+"""
+Registry of the sweep kernels available in this environment.
+
+Every backend turns an N x N int32 lattice into a runner advancing it by
+a number of Metropolis sweeps. On first use for a lattice size the
+available backends are timed on a short run and the fastest is
+remembered, both for the session and in a small JSON cache on disk
+(keyed by the set of backends and the library file, so that rebuilding
+invalidates it). Only seeded backends that update the lattice correctly
+take part; the others ('mcmove', 'wasm') run only when forced with `use`
+or $COMPDISMATTER_BACKEND, which override the choice.
+
+Example usage:
+
+    from compdismatter import backends
+    backends.available()          # ['native', 'mcmove', 'numpy']
+    backends.select(256)          # benchmarked once, then cached
+    backends.use('numpy')         # force a backend
+"""
+import json
+import os
+import sys
+import time
+import numpy as np
+from . import core
+
+class Backend:
+    def __init__(self, name, available, make, description='', automatic=True):
+        """
+        A sweep kernel.
+
+        available() tells whether it can run here; make(config, beta, seed)
+        returns run(nsweeps), advancing config in place. automatic backends
+        may be chosen by select; the others only on request.
+        """
+        self.name = name
+        self.available = available
+        self.make = make
+        self.description = description
+        self.automatic = automatic
+
+_registry = {}
+_chosen = {}
+_override = None
+
+def register(name, available, make, description='', automatic=True):
+    """ Add a backend (or replace one of the same name) """
+    _registry[name] = Backend(name, available, make, description, automatic)
+    _chosen.clear()
+
+def available():
+    """ Names of the backends that can run here, in registration order """
+    return [name for name, b in _registry.items() if b.available()]
+
+def get(name):
+    if name not in _registry:
+        raise KeyError(f"unknown backend {name}; registered: {list(_registry)}")
+    backend = _registry[name]
+    if not backend.available():
+        raise RuntimeError(f"backend {name} is not available here")
+    return backend
+
+def use(name=None):
+    """ Force a backend for all sizes (None restores automatic selection) """
+    global _override
+    if name is not None:
+        get(name)
+    _override = name
+
+def cache_path():
+    return os.environ.get('COMPDISMATTER_CACHE',
+                          os.path.join(os.path.expanduser('~'), '.cache', 'compdismatter', 'backends.json'))
+
+def _fingerprint():
+    parts = available()
+    path = getattr(core, 'lib_path', None)
+    if path:
+        parts.append(f"{path}:{os.path.getmtime(path):.0f}")
+    return '|'.join(parts)
+
+def _load_cache():
+    try:
+        with open(cache_path()) as f:
+            cache = json.load(f)
+    except (OSError, ValueError):
+        return {}
+    return cache.get('choices', {}) if cache.get('fingerprint') == _fingerprint() else {}
+
+def _save_cache(choices):
+    path = cache_path()
+    try:
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path + '.tmp', 'w') as f:
+            json.dump({'fingerprint': _fingerprint(), 'choices': choices}, f, indent=1)
+        os.replace(path + '.tmp', path)
+    except OSError:
+        pass    # a read-only home only costs a benchmark per session
+
+def benchmark(N, names=None, budget=0.05, temperature=2.5):
+    """ Sweeps per second of each backend on an N x N lattice, each timed for about budget seconds """
+    rng = np.random.default_rng(0)
+    rates = {}
+    for name in names or available():
+        config = (2*rng.integers(2, size=(N, N)) - 1).astype(np.int32)
+        run = _registry[name].make(config, 1.0/temperature, 1)
+        run(1)
+        sweeps, elapsed = 1, 0.0
+        while elapsed < budget:
+            start = time.perf_counter()
+            run(sweeps)
+            elapsed = time.perf_counter() - start
+            if elapsed < budget:
+                sweeps *= 2
+        rates[name] = sweeps / elapsed
+    return rates
+
+def select(N):
+    """ The backend to use for N x N lattices """
+    name = _override or os.environ.get('COMPDISMATTER_BACKEND')
+    if name:
+        return get(name)
+    if N not in _chosen:
+        names = [name for name in available() if _registry[name].automatic]
+        choices = _load_cache()
+        choice = choices.get(str(N))
+        if choice not in names:
+            rates = benchmark(N, names) if len(names) > 1 else {names[0]: 1.0}
+            choice = max(rates, key=rates.get)
+            choices[str(N)] = choice
+            _save_cache(choices)
+        _chosen[N] = choice
+    return _registry[_chosen[N]]
+
+def _native(config, beta, seed):
+    state = core.new_state(config, beta, seed)
+    return lambda nsweeps: core.run(state, nsweeps)
+
+def _loop(config, beta, seed):
+    N = config.shape[0]
+    def run(nsweeps):
+        for _ in range(nsweeps):
+            core.mcmove_wrapper(config, N, beta)
+    return run
+
+def _numpy(config, beta, seed):
+    from .checkerboard import Checkerboard
+    kernel = Checkerboard(config.shape[0], seed)
+    def run(nsweeps):
+        for _ in range(nsweeps):
+            kernel.sweep(config, beta)
+    return run
+
+register('native', lambda: core.has_kernels, _native, 'native run loop with per-state RNG')
+# neither takes a seed (mcmove uses C rand()), and under pyodide the
+# placeholder mcmove_wrapper does not write the lattice back
+register('mcmove', lambda: core.lib is not None, _loop, 'native mcmove, one call per sweep', automatic=False)
+register('wasm', lambda: 'pyodide' in sys.modules and not core.python_mcmove, _loop,
+         'WebAssembly mcmove under pyodide', automatic=False)
+register('numpy', lambda: True, _numpy, 'vectorised numpy checkerboard')
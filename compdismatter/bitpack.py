@@ -0,0 +1,42 @@
+"""
+Conversion between the int32 lattice used by `mcmove` and the compact
+bit-packed layout (one bit per spin, 64 spins per word) used by the
+bit-parallel kernels.
+"""
+import ctypes
+import numpy as np
+from .core import native
+
+lattice_t = np.ctypeslib.ndpointer(np.int32, flags='C_CONTIGUOUS')
+packed_t = np.ctypeslib.ndpointer(np.uint64, flags='C_CONTIGUOUS')
+
+_pack = native('pack_lattice', [lattice_t, packed_t, ctypes.c_int])
+_unpack = native('unpack_lattice', [packed_t, lattice_t, ctypes.c_int])
+_energy = native('packed_energy', [packed_t, ctypes.c_int], ctypes.c_longlong)
+_magnetisation = native('packed_magnetisation', [packed_t, ctypes.c_int], ctypes.c_longlong)
+
+def words(N):
+    """ Number of 64-bit words holding one row of an N x N lattice """
+    return (N + 63) // 64
+
+def pack(config):
+    """ Pack an N x N lattice of +-1 spins into an (N, words(N)) uint64 array """
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    N = config.shape[0]
+    packed = np.empty((N, words(N)), dtype=np.uint64)
+    _pack(config, packed, N)
+    return packed
+
+def unpack(packed, N):
+    """ Unpack a bit-packed lattice back into an N x N int32 array of +-1 spins """
+    config = np.empty((N, N), dtype=np.int32)
+    _unpack(np.ascontiguousarray(packed), config, N)
+    return config
+
+def energy(packed, N):
+    """ Energy of a bit-packed configuration """
+    return _energy(packed, N)
+
+def magnetisation(packed, N):
+    """ Magnetisation of a bit-packed configuration """
+    return _magnetisation(packed, N)
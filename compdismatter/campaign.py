@@ -0,0 +1,205 @@
+"""
+Finite-size-scaling campaigns: one run for every (N, T, seed) of a grid.
+
+Jobs are ordered longest first by an estimate of their cost, so that the
+largest lattices do not start last and leave the pool idle, and run on a
+thread or process pool. Every finished job appends one line to the results
+file, which is both the checkpoint (an interrupted campaign skips what is
+already there when started again) and the consolidated output. The runs
+themselves go through a results.ResultCache, so increasing production
+later only computes the extra sweeps.
+
+Example usage:
+
+    campaign = Campaign(sizes=[16, 32, 64], temperatures=np.linspace(2.1, 2.4, 13), seeds=range(4),
+                        equilibration=2000, production=20000, path='fss.jsonl')
+    table = campaign.run()
+    U = binder(table)                       # per (N, T), averaged over seeds
+    crossings(U)                            # Tc estimates from successive sizes
+    x, y = collapse(table, Tc=2.269, nu=1, N=32)
+"""
+import json
+import os
+import concurrent.futures
+import numpy as np
+from .moments import QUANTITIES
+from .results import ResultCache
+
+# every quantity with its jackknife error over the run, e.g. u4 and u4_err
+FIELDS = ('N', 'T', 'seed', 'equilibration', 'production') + QUANTITIES + tuple(q + '_err' for q in QUANTITIES)
+
+def _run_job(root, N, T, seed, equilibration, production):
+    result = ResultCache(root).run(N, T, equilibration, production, seed)
+    row = {'N': N, 'T': T, 'seed': seed, 'equilibration': equilibration, 'production': production}
+    values, errors = result.observables(production)
+    row.update({q: float(values[q]) for q in QUANTITIES})
+    row.update({q + '_err': float(errors[q]) for q in QUANTITIES})
+    return row
+
+def _repair(path):
+    """ Drop a partial last line left by an interrupted campaign """
+    if not os.path.exists(path):
+        return
+    with open(path, 'rb+') as f:
+        data = f.read()
+        if data and not data.endswith(b'\n'):
+            f.truncate(data.rfind(b'\n') + 1)
+
+def load(path):
+    """ The results file as a structured array, one row per job (a truncated last line is ignored) """
+    rows = []
+    if os.path.exists(path):
+        with open(path) as f:
+            for line in f:
+                try:
+                    rows.append(json.loads(line))
+                except ValueError:
+                    break
+    dtype = [(k, np.int64 if k in ('N', 'seed', 'equilibration', 'production') else np.float64) for k in FIELDS]
+    # rows written before errors were recorded have none
+    return np.array([tuple(r.get(k, np.nan) for k in FIELDS) for r in rows], dtype=dtype)
+
+class Campaign:
+    def __init__(self, sizes, temperatures, seeds=(0,), equilibration=1024, production=1024,
+                 path='campaign.jsonl', cache=None, workers=None, executor='thread'):
+        """
+        A grid of simulations.
+
+        Parameters:
+        -----------
+        sizes, temperatures, seeds : sequences
+            The grid; every combination is one job
+        equilibration, production : int
+            Sweeps of every job
+        path : str
+            Results file (JSON lines), also the checkpoint
+        cache : str
+            Directory of the result cache (default: path + '.runs')
+        workers : int
+            Pool size (default: the number of CPUs)
+        executor : 'thread' or 'process'
+        """
+        self.sizes = [int(N) for N in sizes]
+        self.temperatures = [float(T) for T in temperatures]
+        self.seeds = [int(s) for s in seeds]
+        self.equilibration = equilibration
+        self.production = production
+        self.path = path
+        self.cache = cache or path + '.runs'
+        self.workers = workers or os.cpu_count()
+        if executor not in ('thread', 'process'):
+            raise ValueError("executor must be 'thread' or 'process'")
+        self.executor = executor
+
+    def cost(self, N):
+        """ Estimated cost of one job on an N x N lattice, in spin updates (all jobs use the native kernel) """
+        return N*N * (self.equilibration + self.production)
+
+    def jobs(self):
+        """ All (N, T, seed) of the grid, most expensive first """
+        jobs = [(N, T, s) for N in self.sizes for T in self.temperatures for s in self.seeds]
+        cost = {N: self.cost(N) for N in self.sizes}
+        return sorted(jobs, key=lambda job: -cost[job[0]])
+
+    def table(self):
+        """
+        The rows of the results file belonging to this campaign: its grid,
+        equilibration and production, the latest row per job
+        """
+        table = load(self.path)
+        grid = set(self.jobs())
+        latest = {}
+        for k, r in enumerate(table):
+            job = (int(r['N']), float(r['T']), int(r['seed']))
+            if job in grid and r['equilibration'] == self.equilibration and r['production'] == self.production:
+                latest[job] = k
+        return table[sorted(latest.values())]
+
+    def pending(self):
+        """ Jobs not yet in the results file """
+        table = self.table()
+        done = {(int(r['N']), float(r['T']), int(r['seed'])) for r in table}
+        return [job for job in self.jobs() if job not in done]
+
+    def run(self, progress=None):
+        """
+        Run the pending jobs and return the table of this campaign (see table()).
+
+        progress(done, total) is called after every job. A failing job does
+        not stop the others: their rows are still written, and a RuntimeError
+        listing the failed jobs is raised once the pool is done.
+        """
+        _repair(self.path)
+        jobs = self.pending()
+        total = len(self.jobs())
+        done = total - len(jobs)
+        Pool = (concurrent.futures.ThreadPoolExecutor if self.executor == 'thread'
+                else concurrent.futures.ProcessPoolExecutor)
+        with Pool(max_workers=self.workers) as pool, open(self.path, 'a') as out:
+            futures = {pool.submit(_run_job, self.cache, N, T, s, self.equilibration, self.production): (N, T, s)
+                       for N, T, s in jobs}
+            failed = {}
+            for future in concurrent.futures.as_completed(futures):
+                try:
+                    row = future.result()
+                except Exception as error:
+                    failed[futures[future]] = error
+                    continue
+                out.write(json.dumps(row) + '\n')
+                out.flush()
+                done += 1
+                if progress:
+                    progress(done, total)
+        if failed:
+            lines = [f"  N={N} T={T} seed={s}: {error!r}" for (N, T, s), error in failed.items()]
+            raise RuntimeError(f"{len(failed)} of {len(jobs)} jobs failed:\n" + '\n'.join(lines)) \
+                from next(iter(failed.values()))
+        return self.table()
+
+def binder(table, quantity='u4'):
+    """
+    Seed average of a quantity per (N, T).
+
+    Returns a structured array with N, T, the mean, its standard error
+    over seeds and the number of seeds.
+    """
+    keys = sorted({(int(r['N']), float(r['T'])) for r in table})
+    out = np.zeros(len(keys), dtype=[('N', np.int64), ('T', np.float64), ('mean', np.float64),
+                                     ('error', np.float64), ('seeds', np.int64)])
+    for i, (N, T) in enumerate(keys):
+        values = table[quantity][(table['N'] == N) & (table['T'] == T)]
+        error = values.std(ddof=1) / np.sqrt(len(values)) if len(values) > 1 else np.nan
+        out[i] = (N, T, values.mean(), error, len(values))
+    return out
+
+def crossings(averages):
+    """
+    Temperatures where the curves of successive sizes cross, from binder().
+
+    Returns a list of (N1, N2, T) with T linearly interpolated between grid
+    temperatures; pairs that do not cross on the grid are skipped.
+    """
+    sizes = sorted(set(averages['N']))
+    result = []
+    for N1, N2 in zip(sizes, sizes[1:]):
+        a = averages[averages['N'] == N1]
+        b = averages[averages['N'] == N2]
+        T, i, j = np.intersect1d(a['T'], b['T'], return_indices=True)
+        d = a['mean'][i] - b['mean'][j]
+        for k in np.nonzero(np.sign(d[:-1]) * np.sign(d[1:]) < 0)[0]:
+            result.append((int(N1), int(N2), float(T[k] - d[k] * (T[k+1] - T[k]) / (d[k+1] - d[k]))))
+    return result
+
+def collapse(table, Tc, nu, quantity='u4', exponent=0.0, N=None):
+    """
+    Scaling variables of a quantity: x = (T - Tc) N^(1/nu), y = Q N^(-exponent).
+
+    Use exponent gamma/nu for chi, beta/nu with a negative sign for m, 0 for u4.
+    Seeds are averaged; N restricts to one size, otherwise x and y cover
+    all rows of binder() in its order.
+    """
+    averages = binder(table, quantity)
+    if N is not None:
+        averages = averages[averages['N'] == N]
+    L = averages['N'].astype(float)
+    return (averages['T'] - Tc) * L**(1.0/nu), averages['mean'] * L**(-exponent)
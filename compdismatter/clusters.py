@@ -0,0 +1,96 @@
+"""
+Cluster analysis of lattice snapshots: Hoshen-Kopelman labelling of
+nearest-neighbour clusters with periodic boundaries, cluster sizes, their
+distribution and wrapping (spanning) information.
+"""
+import ctypes
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+from .core import native
+from .bitpack import words
+
+_int_p = np.ctypeslib.ndpointer(np.int32, flags='C_CONTIGUOUS')
+_uint8_p = np.ctypeslib.ndpointer(np.uint8, flags='C_CONTIGUOUS')
+_uint64_p = np.ctypeslib.ndpointer(np.uint64, flags='C_CONTIGUOUS')
+
+_label_rows = native('label_rows', [_int_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, _int_p,
+                                    _uint64_p, _uint64_p, _int_p])
+_label_join = native('label_join', [ctypes.c_int, ctypes.c_int, _int_p, ctypes.c_int, _int_p, _uint64_p,
+                                    _uint64_p, _int_p, _int_p, ctypes.c_int, _uint8_p,
+                                    ctypes.POINTER(ctypes.c_int)], ctypes.c_int)
+_label_write = native('label_write', [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, _int_p, _uint64_p,
+                                      _uint64_p, _int_p])
+_cluster_sizes = native('cluster_sizes', [_int_p, ctypes.c_long, _int_p, ctypes.c_int])
+
+class Clusters:
+    """
+    Result of labelling a configuration.
+
+    labels : (N, N) int32 cluster index of every site, -1 for excluded sites
+    sizes : number of sites in each cluster
+    wraps_x, wraps_y : whether each cluster wraps around the lattice
+    """
+    def __init__(self, labels, sizes, wraps):
+        self.labels = labels
+        self.sizes = sizes
+        self.wraps_x = (wraps & 1).astype(bool)
+        self.wraps_y = (wraps & 2).astype(bool)
+
+    @property
+    def largest(self):
+        return self.sizes.max() if len(self.sizes) else 0
+
+    @property
+    def largest_fraction(self):
+        return self.largest / self.labels.size
+
+    @property
+    def spanning(self):
+        """ Whether any cluster wraps around the lattice in either direction """
+        return bool(np.any(self.wraps_x | self.wraps_y))
+
+    def distribution(self):
+        """ Cluster-size distribution n_s: number of clusters of size s per site, for s = 0 .. largest """
+        return np.bincount(self.sizes, minlength=self.largest + 1) / self.labels.size
+
+def label_clusters(config, spin=1, threads=4):
+    """
+    Label the clusters of a configuration.
+
+    Parameters:
+    -----------
+    config : ndarray
+        N x N int32 lattice, e.g. `IsingModel.config`; read in place when C-contiguous
+    spin : int
+        +1 or -1 to label only clusters of that spin, 0 to label every domain
+    threads : int
+        Worker threads; the rows are split into one strip per thread
+    """
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    N = config.shape[0]
+    n = N*N
+    strips = np.unique(np.linspace(0, N, min(threads, N) + 1).astype(np.int32))
+    bounds = list(zip(strips[:-1], strips[1:]))
+    labels = np.empty((N, N), dtype=np.int32)
+    packed = np.empty(N*words(N), dtype=np.uint64)
+    rows = np.empty((len(bounds), 2*words(N)), dtype=np.uint64)
+    work = np.empty(30*N, dtype=np.int32)
+    wraps = np.zeros(4*N, dtype=np.uint8)
+    # at most n/2 + 1 clusters of one spin; only domains (spin = 0) of a
+    # near-checkerboard can have more, and are counted in a second pass
+    capacity = n // 2 + 1
+    sizes = np.empty(capacity, dtype=np.int32)
+    nboundary = ctypes.c_int()
+    with ThreadPoolExecutor(len(bounds)) as pool:
+        list(pool.map(lambda k: _label_rows(config, N, spin, *bounds[k], labels, packed, rows[k], work),
+                      range(len(bounds))))
+        K = _label_join(N, spin, strips[:-1].copy(), len(bounds), labels, packed, rows[0], work, sizes, capacity,
+                        wraps, nboundary)
+        list(pool.map(lambda k: _label_write(N, spin, *bounds[k], labels, packed, rows[k], work),
+                      range(len(bounds))))
+    if K > capacity:
+        sizes = np.empty(K, dtype=np.int32)
+        _cluster_sizes(labels, n, sizes, K)
+    flags = np.zeros(K, dtype=np.uint8)
+    flags[:nboundary.value] = wraps[:nboundary.value]
+    return Clusters(labels, sizes[:K].copy(), flags)
@@ -0,0 +1,118 @@
+"""
+Domain growth after a quench: the coarsening length L(t) measured three
+ways at logarithmically spaced sweeps, entirely inside the native sweep
+loop.
+
+At every scheduled sweep one row is added to a table with the energy and
+magnetisation per spin, L from the excess energy over equilibrium, the
+first zero of the connected G(r), the first two moments of S(k) and
+2 pi / <k>.
+"""
+import ctypes
+import numpy as np
+from .core import native, run_quench, Observer, OBS_COARSENING
+from .structure import FFTPlan, _FFTPlan
+
+COLUMNS = ('sweep', 'e', 'm', 'L_energy', 'L_zero', 'k1', 'k2', 'L_k')
+
+class _Coarsening(ctypes.Structure):
+    _fields_ = [('plan', ctypes.POINTER(_FFTPlan)),
+                ('schedule', ctypes.c_void_p),
+                ('nschedule', ctypes.c_int),
+                ('next', ctypes.c_int),
+                ('e_eq', ctypes.c_double),
+                ('table', ctypes.c_void_p),
+                ('power', ctypes.c_void_p),
+                ('corr', ctypes.c_void_p),
+                ('radial', ctypes.c_void_p)]
+
+_measure_coarsening = native('measure_coarsening', [ctypes.POINTER(_Coarsening), ctypes.c_void_p])
+
+def onsager_energy(temperature):
+    """ Exact energy per spin of the infinite square-lattice Ising model """
+    b = 1.0/temperature
+    k = 2*np.sinh(2*b) / np.cosh(2*b)**2
+    # complete elliptic integral K(k) from the arithmetic-geometric mean
+    a, g = 1.0, np.sqrt(max(1 - k*k, 0.0))
+    if g == 0:
+        return -np.sqrt(2)
+    while abs(a - g) > 1e-15*a:
+        a, g = 0.5*(a + g), np.sqrt(a*g)
+    K = np.pi / (2*a)
+    return -(1 + 2/np.pi*(2*np.tanh(2*b)**2 - 1)*K) / np.tanh(2*b)
+
+def log_schedule(nsweeps, points=50):
+    """ About `points` distinct sweep indices spaced logarithmically in 1 .. nsweeps """
+    return np.unique(np.geomspace(1, nsweeps, points).astype(np.int64))
+
+class Coarsening:
+    def __init__(self, N, schedule, e_eq=None, plan=None):
+        """
+        In-kernel coarsening tracker.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N), a power of two
+        schedule : array of int
+            Increasing sweep indices at which to measure; sweep 0 is the
+            configuration before the first sweep
+        e_eq : float
+            Equilibrium energy per spin at the quench temperature (default:
+            Onsager's value at the temperature of the run)
+        plan : FFTPlan
+            Plan to share with other measurements of the same size
+
+        Example usage:
+
+        tracker = Coarsening(N=512, schedule=log_schedule(10000))
+        tracker.quench(temperature=1.5, nsweeps=10000)
+        t, L = tracker['sweep'], tracker['L_energy']
+        """
+        self.N = N
+        self.schedule = np.ascontiguousarray(schedule, dtype=np.int64)
+        if np.any(np.diff(self.schedule) <= 0):
+            raise ValueError("the schedule must be strictly increasing")
+        self.e_eq = e_eq
+        self.plan = plan or FFTPlan(N)
+        if not self.plan.native:
+            raise ValueError("the coarsening tracker needs N to be a power of two")
+        H = N//2 + 1
+        self.table = np.full((len(self.schedule), len(COLUMNS)), np.nan)
+        self._power = np.empty((N, H))
+        self._corr = np.empty((N, H))
+        self._radial = np.empty(self.plan.nbins)
+        self._data = _Coarsening(ctypes.pointer(self.plan.plan), self.schedule.ctypes.data, len(self.schedule),
+                                 0, 0.0, self.table.ctypes.data, self._power.ctypes.data,
+                                 self._corr.ctypes.data, self._radial.ctypes.data)
+
+    def __getitem__(self, column):
+        """ One column of the rows measured so far, by name """
+        return self.table[:self._data.next, COLUMNS.index(column)]
+
+    def _bind(self, state):
+        if state.N != self.N:
+            raise ValueError("tracker and lattice sizes differ")
+        self._data.e_eq = self.e_eq if self.e_eq is not None else onsager_energy(1.0/state.beta)
+
+    def observer(self, state):
+        self._bind(state)
+        return Observer(OBS_COARSENING, 1, ctypes.addressof(self._data))
+
+    def reset(self):
+        """ Forget the rows measured so far """
+        self._data.next = 0
+        self.table.fill(np.nan)
+
+    def record(self, state):
+        """ Measure now if the state's sweep count is due in the schedule """
+        self._bind(state)
+        _measure_coarsening(self._data, ctypes.addressof(state))
+
+    def quench(self, temperature, nsweeps=None, config=None, seed=None):
+        """
+        Quench from infinite temperature (or from config) to the given
+        temperature and run up to the last scheduled sweep.
+        """
+        self.config, self.state = run_quench(self, temperature, nsweeps, config, seed)
+        return self
@@ -1,19 +1,29 @@
 # First  checking that the environment is web or local
+import os
 import sys
 # Initialize a variable to hold the mc_move function
 mcmove = None
+# The native library, when available, exposes the other kernels as well
+lib = None
+# Location of the package, for finding the compiled kernels wherever it is installed
+package_dir = os.path.dirname(os.path.abspath(__file__))
 
 # Check if running in a WebAssembly environment (via Pyodide)
 if 'pyodide' in sys.modules:
     # Import Pyodide's API
     import pyodide
     
-    # Load the WebAssembly module (ensure the path is correct based on your package structure)
-    wasm = pyodide.open_url('compdismatter/wasm/ising.wasm')
-    
-    # Get the mcmove function from the WASM module
-    mcmove = wasm.exports['mcmove']
-    print("Using mcmove from WebAssembly")
+    # Load the WebAssembly module (ensure the path is correct based on your package structure);
+    # if it is missing or lacks mcmove, the numpy fallback below takes over
+    try:
+        wasm = pyodide.open_url('compdismatter/wasm/ising.wasm')
+        # Get the mcmove function from the WASM module
+        mcmove = wasm.exports['mcmove']
+        print("Using mcmove from WebAssembly")
+    except Exception:
+        mcmove = None
+    # mcmove runs on the page's main thread here; long runs belong in a Web
+    # Worker, see webworker.WorkerSimulation
     
 # Check if running in a native Python environment (for example, when using a shared library)
 elif sys.platform != "emscripten":
@@ -25,24 +35,56 @@ elif sys.platform != "emscripten":
 
     def get_float(value):
         return ctypes.c_float(value)
-    # Load the shared object (.so) library
-    lib = ctypes.CDLL('compdismatter/lib/ising.so')
-    # Declare the function signature
-    lib.mcmove.argtypes = [ctypes.POINTER(ctypes.c_int), ctypes.c_int, ctypes.c_double]
-    lib.mcmove.restype = None
-    # Get the mcmove function from the shared object library
-    mcmove = lib.mcmove
-    print("Using mcmove from native .so library")
+
+    # Candidate shared objects: $COMPDISMATTER_LIB, the installed library and
+    # the one `make` builds. The first with the full kernel set wins; a
+    # library with only mcmove is kept as a last resort.
+    lib_candidates = [os.environ.get('COMPDISMATTER_LIB'),
+                      os.path.join(package_dir, 'lib', 'ising.so'),
+                      os.path.join(package_dir, 'wasm', 'ising.so')]
+    lib_path = None
+    for path in filter(None, lib_candidates):
+        try:
+            candidate = ctypes.CDLL(path)
+        except OSError:
+            continue
+        if lib is None or hasattr(candidate, 'metropolis_run'):
+            lib, lib_path = candidate, path
+        if hasattr(lib, 'metropolis_run'):
+            break
+    if lib is not None:
+        # Declare the function signature
+        lib.mcmove.argtypes = [ctypes.POINTER(ctypes.c_int), ctypes.c_int, ctypes.c_double]
+        lib.mcmove.restype = None
+        # Get the mcmove function from the shared object library
+        mcmove = lib.mcmove
+        print("Using mcmove from native .so library")
     
 else:
     print("Environment not recognized for mcmove")
 
-# Ensure that mcmove is set
-if mcmove is None:
-    raise ImportError("Could not load mcmove from either WASM or native library.")
+# Without WASM or native code, fall back to vectorised numpy sweeps
+python_mcmove = mcmove is None
+if python_mcmove:
+    from .checkerboard import checkerboard_mcmove as mcmove
+    print("Using the vectorised numpy checkerboard mcmove")
+
+# The run-loop kernels (new_state, run and everything built on them)
+has_kernels = lib is not None and hasattr(lib, 'metropolis_run')
+
+def native(name, argtypes, restype=None):
+    """ Declare the signature of a function exported by the native library and return it """
+    if not has_kernels:
+        raise ImportError(f"{name} requires the native ising library")
+    func = getattr(lib, name)
+    func.argtypes = argtypes
+    func.restype = restype
+    return func
 
 def mcmove_wrapper(lattice, N, beta):
-    if 'pyodide' in sys.modules:
+    if python_mcmove:
+        mcmove(lattice, N, beta)
+    elif 'pyodide' in sys.modules:
         # WebAssembly-specific logic: Pass array as memory or shared buffer
         # This would use pyodide or wasm-specific handling
         import js
@@ -58,6 +100,91 @@ def mcmove_wrapper(lattice, N, beta):
 import numpy as np
 from numpy.random import rand
 import matplotlib.pyplot as plt
+import ctypes
+
+class State(ctypes.Structure):
+    """ Mirror of ising_state: a lattice plus everything the native run loop tracks """
+    _fields_ = [('lattice', ctypes.POINTER(ctypes.c_int)),
+                ('N', ctypes.c_int),
+                ('beta', ctypes.c_double),
+                ('rng', ctypes.c_uint64),
+                ('sweep', ctypes.c_longlong),
+                ('E', ctypes.c_longlong),
+                ('M', ctypes.c_longlong)]
+
+# The same layout as a numpy dtype, for viewing arrays of states
+state_dtype = np.dtype([('lattice', np.uintp), ('N', np.int32), ('beta', np.float64), ('rng', np.uint64),
+                        ('sweep', np.int64), ('E', np.int64), ('M', np.int64)], align=True)
+
+class Observer(ctypes.Structure):
+    """ Mirror of observer: an in-kernel measurement called every `every` sweeps """
+    _fields_ = [('kind', ctypes.c_int),
+                ('every', ctypes.c_int),
+                ('data', ctypes.c_void_p)]
+
+# Observer kinds, matching the enum in ising.h
+OBS_ENERGY_HISTOGRAM = 1
+OBS_MAGNETISATION_HISTOGRAM = 2
+OBS_STRUCTURE_FACTOR = 3
+OBS_COARSENING = 4
+OBS_MCRG = 5
+OBS_MOVIE = 6
+OBS_SNAPSHOT = 7
+OBS_SERIES = 8
+OBS_MOMENTS = 9
+OBS_AGING = 10
+
+if has_kernels:
+    _state_init = native('state_init', [ctypes.POINTER(State)])
+    _metropolis_run = native('metropolis_run', [ctypes.POINTER(State), ctypes.c_longlong,
+                                                ctypes.POINTER(Observer), ctypes.c_int])
+
+def new_state(config, beta, seed):
+    """ Native run state for config (int32, C-contiguous, updated in place) """
+    if config.dtype != np.int32 or not config.flags['C_CONTIGUOUS']:
+        raise ValueError("config must be a C-contiguous int32 array")
+    state = State(get_lattice_pointer(config), config.shape[0], beta, seed, 0, 0, 0)
+    state.config = config  # keep the lattice alive as long as the state
+    _state_init(state)
+    return state
+
+def run(state, nsweeps, measure=()):
+    """
+    Advance a native state by nsweeps Metropolis sweeps.
+
+    Each object in measure provides observer(state), returning the Observer
+    that accumulates its measurement inside the sweep loop.
+    """
+    observers = (Observer * len(measure))(*[m.observer(state) for m in measure])
+    _metropolis_run(state, nsweeps, observers, len(measure))
+
+def run_quench(measurement, temperature, nsweeps=None, config=None, seed=None):
+    """
+    Quench from infinite temperature (or from config) to the given
+    temperature, measuring from sweep 0 for nsweeps sweeps (default: up to
+    the last sweep of measurement.schedule). The measurement is reset first,
+    so it may be quenched again. Returns the configuration and the state.
+    """
+    if nsweeps is None:
+        if not len(measurement.schedule):
+            raise ValueError("nsweeps is required when the schedule is empty")
+        nsweeps = int(measurement.schedule[-1])
+    N = measurement.N
+    rng = np.random.default_rng(seed)
+    if config is None:
+        config = (2*rng.integers(2, size=(N, N)) - 1).astype(np.int32)
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    state = new_state(config, 1.0/temperature, int(rng.integers(2**63)))
+    measurement.reset()
+    measurement.record(state)
+    run(state, nsweeps, [measurement])
+    return config, state
+
+def random_start(N, seed):
+    """ Random N x N int32 configuration and kernel seed, both derived from seed """
+    rng = np.random.default_rng(seed)
+    config = (2*rng.integers(2, size=(N, N)) - 1).astype(np.int32)
+    return config, int(rng.integers(2**63))
 
 class IsingModel:
     def __init__(self, N, equilibration=1024, production=1024):
@@ -88,16 +215,11 @@ class IsingModel:
         self.N = N
         self.equilibration = equilibration
         self.production = production
-        
-        
-        # Normalization factors
-        self.n1 = 1.0/(production*N*N)
-        self.n2 = 1.0/(production*production*N*N)
     
     def initialstate(self):
         """ Generate a random spin configuration for initial condition """
-        np.random.seed(1234)  # For reproducibility
-        state = 2*np.random.randint(2, size=(self.N, self.N),dtype=np.int32)-1
+        rng = np.random.default_rng(1234)  # reproducible, without reseeding numpy's global RNG
+        state = 2*rng.integers(2, size=(self.N, self.N), dtype=np.int32)-1
         return state
     
     def vanilla_mcmove(self, config, beta):
@@ -129,58 +251,118 @@ class IsingModel:
                 energy += -nb*S
         return energy/4.
     
+    def clusters(self, spin=1):
+        """ Clusters of the given spin (0: all domains) in the current configuration """
+        from .clusters import label_clusters
+        return label_clusters(self.config, spin)
+
     def calcMag(self, config):
         """ Magnetization of a given configuration """
         return np.sum(config)
     
-    def simulate(self, temperature=1.0):
-        """ Run the simulation for all temperature points """
+    def simulate(self, temperature=1.0, measure=(), cache=None, seed=0):
+        """
+        Run the simulation at the given temperature.
+
+        measure is a list of in-kernel measurements (e.g. reweighting.EnergyHistogram)
+        accumulated every production sweep; it requires the native library.
+        Otherwise the sweeps run on the fastest backend for this lattice size
+        (see backends). seed determines the initial configuration and the
+        kernel's random numbers.
+
+        With a results.ResultCache, runs already stored under the same N,
+        temperature, equilibration and seed are reused (and extended when
+        more production sweeps are asked for); self.result is the stored run.
+
+        Afterwards self.results and self.errors hold e, m, c, chi and u4 per
+        spin with their jackknife errors (see moments.Moments), also
+        available as self.E, self.M, self.C, self.X and self.U4.
+        """
+        from . import backends
+        from .moments import Moments
+        iT = 1.0/temperature
+        if cache is not None:
+            if measure:
+                raise ValueError("In-kernel measurements cannot be combined with a result cache")
+            self.backend = 'native'
+            self.result = cache.run(self.N, temperature, self.equilibration, self.production, seed)
+            self.config = self.result.config
+            self.moments = Moments.from_series(self.result.column('E', self.production),
+                                               self.result.column('M', self.production), self.N, iT)
+            self._set_results()
+            return
+
         self.exp_cache = {2*d: np.exp(-2*d/temperature) for d in range(5)}
-        T = temperature
-        E1 = M1 = E2 = M2 = 0
-        config = self.initialstate()
-        iT = 1.0/T
-        iT2 = iT*iT
-        
-        beginning = config.copy()
+        # the same start as a cached run with this seed
+        config, seed = random_start(self.N, seed)
+
+        if measure and not has_kernels:
+            raise RuntimeError("In-kernel measurements require the native ising library")
+        backend = backends.get('native') if measure else backends.select(self.N)
+        self.backend = backend.name
+        if backend.name == 'native':
+            self.moments = Moments(self.N)
+            self.state = new_state(config, iT, seed)
+            run(self.state, self.equilibration)
+            run(self.state, self.production, list(measure) + [self.moments])
+            self.config = config
+            self._set_results()
+            return
+        sweep = backend.make(config, iT, seed)
+
         # Equilibration phase
-        for i in range(self.equilibration):
-            # print(i)
-            # print(config)
-            mcmove_wrapper(config,self.N ,iT)
-            # print(config)
+        sweep(self.equilibration)
 
         self.config = config
-        print(config==beginning)
 
-        
-        print("production")
-        # Measurement phase
+        # Measurement phase: the other backends only advance the lattice, so
+        # E and M are computed here, vectorised
+        E = np.empty(self.production, dtype=np.int64)
+        M = np.empty(self.production, dtype=np.int64)
         for i in range(self.production):
-            print(i)
-            mcmove_wrapper(config,self.N ,iT)
-            self.config = config
-            
-    
-            # Ene = self.calcEnergy(config)
-            # Mag = self.calcMag(config)
-            
-            # E1 += Ene
-            # M1 += Mag
-            # M2 += Mag*Mag
-            # E2 += Ene*Ene
-        
-        # Calculate observables
-        # self.E = self.n1 * E1
-        # self.M = self.n1 * M1
-        # self.C = (self.n1 * E2 - self.n2 * E1 * E1) * iT2
-        # self.X = (self.n1 * M2 - self.n2 * M1 * M1) * iT
-        
-    
-    def plot_config(self):
-        """ Plot the results of the simulation """
+            sweep(1)
+            E[i] = -np.sum(config * (np.roll(config, 1, 0) + np.roll(config, 1, 1)))
+            M[i] = np.sum(config)
+        self.moments = Moments.from_series(E, M, self.N, iT)
+        self._set_results()
+
+    def _set_results(self):
+        if not len(self.moments):
+            return
+        self.results, self.errors = self.moments.results()
+        self.E, self.M, self.C, self.X, self.U4 = (self.results[q] for q in ('e', 'm', 'c', 'chi', 'u4'))
+
+    def start(self, temperature=1.0, measure=(), every=1, batch=1000, maxsize=16,
+              progress=None, progress_interval=0.5, seed=0):
+        """
+        Start the simulation in a background thread and return at once.
+
+        The returned stream.Simulation yields batches of the production
+        series (sweep, e and m per spin, every `every` sweeps) to a plain or
+        an async for loop; see stream.Simulation for the other parameters.
+        seed determines the initial configuration and the kernel's random
+        numbers, as in simulate. self.config is the lattice being updated.
+        """
+        if not has_kernels:
+            raise RuntimeError("Background simulations require the native ising library")
+        from .stream import Simulation
+        self.config, seed = random_start(self.N, seed)
+        self.simulation = Simulation(self.config, temperature, self.equilibration, self.production, measure,
+                                     every, batch, maxsize, progress, progress_interval, seed)
+        self.state = self.simulation.state
+        return self.simulation
+
+    def plot_config(self, block=None):
+        """ Plot the results of the simulation, block averaged to at most 1024 pixels across """
         fig,ax = plt.subplots(figsize=(5, 5))
-        ax.matshow(self.config, cmap='copper') 
+        if has_kernels:
+            from .render import render
+            block = block or -(-self.N // 1024)
+            while self.N % block:
+                block += 1
+            ax.imshow(render(self.config, block, 'copper'), interpolation='nearest')
+        else:
+            ax.matshow(self.config, cmap='copper') 
         ax.axis('off')   
         plt.tight_layout()
         plt.show()
\ No newline at end of file
@@ -0,0 +1,129 @@
+"""
+Online moments of the energy and magnetisation, accumulated inside the
+sweep loop.
+
+Moments sums |m|, m^2, m^4, e and e^2 per spin with compensated
+(Neumaier) summation into jackknife blocks, so that a run of any length
+ends with the energy, magnetisation, specific heat, susceptibility and
+Binder cumulant together with their jackknife errors, without any
+per-sweep work in Python. The energy is summed relative to the first
+sample, so the specific heat does not come from cancelling two large sums.
+"""
+import ctypes
+import numpy as np
+from .core import Observer, OBS_MOMENTS
+
+# Columns of the block sums, as in ising.h
+COLUMNS = ('m', 'm2', 'm4', 'de', 'de2')
+QUANTITIES = ('e', 'm', 'c', 'chi', 'u4')
+
+class _Moments(ctypes.Structure):
+    _fields_ = [('nblocks', ctypes.c_int),
+                ('block_size', ctypes.c_longlong),
+                ('count', ctypes.c_longlong),
+                ('e0', ctypes.c_double),
+                ('sum', ctypes.c_void_p),
+                ('comp', ctypes.c_void_p)]
+
+def estimates(means, e0, N, beta):
+    """ e, |m|, c, chi and u4 from the means of the COLUMNS (last axis) """
+    m, m2, m4, de, de2 = np.moveaxis(np.asarray(means), -1, 0)
+    n = N*N
+    return {
+        'e': e0 + de,
+        'm': m,
+        'c': beta*beta*n*(de2 - de*de),
+        'chi': beta*n*(m2 - m*m),
+        'u4': 1 - m4/(3*m2*m2),
+    }
+
+class Moments:
+    def __init__(self, N, blocks=32, every=1):
+        """
+        Moment accumulator for one run.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        blocks : int
+            Jackknife blocks (even); a run ends with between blocks / 2
+            and blocks of them
+        every : int
+            Measure every this many production sweeps
+
+        Example usage:
+
+        acc = Moments(N=32)
+        model.simulate(temperature=2.27, measure=[acc])
+        values, errors = acc.results()
+        """
+        if blocks < 2 or blocks % 2:
+            raise ValueError("blocks must be even")
+        self.N = N
+        self.every = every
+        self.beta = None
+        self.sum = np.zeros((blocks, len(COLUMNS)))
+        self.comp = np.zeros((blocks, len(COLUMNS)))
+        self._data = _Moments(blocks, 1, 0, 0.0, self.sum.ctypes.data, self.comp.ctypes.data)
+
+    @classmethod
+    def from_series(cls, E, M, N, beta, blocks=32):
+        """ The accumulator a run with these E and M series would have produced """
+        acc = cls(N, blocks)
+        acc.beta = beta
+        n = N*N
+        E = np.asarray(E, dtype=float) / n
+        m = np.abs(np.asarray(M, dtype=float)) / n
+        count = len(E)
+        if count:
+            acc._data.e0 = E[0]
+            de = E - E[0]
+            size = 1
+            while count > blocks*size:
+                size *= 2
+            x = np.stack([m, m*m, m**4, de, de*de], axis=1)
+            for k, start in enumerate(range(0, count, size)):
+                acc.sum[k] = x[start:start + size].sum(axis=0)
+            acc._data.block_size = size
+            acc._data.count = count
+        return acc
+
+    def __len__(self):
+        return self._data.count
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("accumulator and lattice sizes differ")
+        if self.beta is not None and self.beta != state.beta:
+            raise ValueError("an accumulator can only collect runs at one temperature")
+        self.beta = state.beta
+        return Observer(OBS_MOMENTS, self.every, ctypes.addressof(self._data))
+
+    def blocks(self):
+        """ Compensated block sums and the number of samples in each non-empty block """
+        count, size = self._data.count, self._data.block_size
+        k = -(-count // size)
+        weights = np.full(k, size, dtype=float)
+        if k:
+            weights[-1] = count - (k - 1)*size
+        return self.sum[:k] + self.comp[:k], weights
+
+    def results(self):
+        """
+        Estimates and jackknife errors of e, m, c, chi and u4.
+
+        Returns two dicts, values and errors, keyed by quantity.
+        """
+        if not len(self):
+            raise ValueError("no samples")
+        sums, weights = self.blocks()
+        total, count = sums.sum(axis=0), weights.sum()
+        e0 = self._data.e0
+        values = estimates(total / count, e0, self.N, self.beta)
+        B = len(weights)
+        if B < 2:
+            return values, {q: np.nan for q in QUANTITIES}
+        loo = estimates((total - sums) / (count - weights)[:, None], e0, self.N, self.beta)
+        errors = {q: np.sqrt((B - 1) / B * np.sum((loo[q] - loo[q].mean())**2)) for q in QUANTITIES}
+        return values, errors
@@ -0,0 +1,50 @@
+"""
+Q2R reversible cellular automaton: deterministic, energy-conserving
+(microcanonical) Ising dynamics on the bit-packed lattice.
+"""
+import ctypes
+import numpy as np
+from .core import native
+from . import bitpack
+
+_q2r = native('q2r', [bitpack.packed_t, ctypes.c_int, ctypes.c_int,
+                      np.ctypeslib.ndpointer(np.int64, flags='C_CONTIGUOUS')], ctypes.c_int)
+
+class Q2R:
+    def __init__(self, config):
+        """
+        Q2R dynamics started from a given configuration.
+
+        Parameters:
+        -----------
+        config : ndarray
+            N x N lattice of +-1 spins (N must be even), e.g. `IsingModel.config`
+
+        Example usage:
+
+        q2r = Q2R(model.config)
+        energies = q2r.run(1000)
+        config = q2r.config
+        """
+        self.N = config.shape[0]
+        if self.N % 2:
+            raise ValueError("Q2R needs an even lattice size")
+        self.packed = bitpack.pack(config)
+        self.energy = bitpack.energy(self.packed, self.N)
+
+    def run(self, nsweeps, check_energy=True):
+        """ Advance by nsweeps and return the energy after each sweep """
+        energies = np.empty(nsweeps, dtype=np.int64)
+        if _q2r(self.packed, self.N, nsweeps, energies) != 0:
+            raise ValueError("Q2R needs an even lattice size")
+        if check_energy and np.any(energies != self.energy):
+            raise RuntimeError("Q2R dynamics did not conserve energy")
+        return energies
+
+    @property
+    def magnetisation(self):
+        return bitpack.magnetisation(self.packed, self.N)
+
+    @property
+    def config(self):
+        return bitpack.unpack(self.packed, self.N)
@@ -0,0 +1,149 @@
+"""
+Native rendering of lattices to images: spins, optionally averaged over
+b x b blocks, are mapped onto a colour map and encoded as PNG, or as an
+animated PNG written frame by frame from inside the sweep loop.
+
+Frames are stored as 8-bit palette images (at most b^2 + 1 colours), which
+keeps even movies of thousands of frames of large lattices compact.
+"""
+import ctypes
+import os
+import numpy as np
+import matplotlib.pyplot as plt
+from .core import native, Observer, OBS_MOVIE
+
+_int_p = np.ctypeslib.ndpointer(np.int32, flags='C_CONTIGUOUS')
+_byte_p = np.ctypeslib.ndpointer(np.uint8, flags='C_CONTIGUOUS')
+
+class _Movie(ctypes.Structure):
+    _fields_ = [('file', ctypes.c_void_p),
+                ('b', ctypes.c_int),
+                ('n', ctypes.c_int),
+                ('ncolors', ctypes.c_int),
+                ('palette', ctypes.c_void_p),
+                ('nframes', ctypes.c_int),
+                ('delay_num', ctypes.c_int),
+                ('delay_den', ctypes.c_int),
+                ('raw', ctypes.c_void_p),
+                ('out', ctypes.c_void_p),
+                ('work', ctypes.c_void_p),
+                ('frames', ctypes.c_int),
+                ('sequence', ctypes.c_int),
+                ('actl', ctypes.c_long),
+                ('error', ctypes.c_int)]
+
+_render_lattice = native('render_lattice', [_int_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, _byte_p])
+_png_encode = native('png_encode', [_int_p, ctypes.c_int, ctypes.c_int, _byte_p, ctypes.c_int,
+                                    _byte_p, _int_p, _byte_p], ctypes.c_long)
+_movie_open = native('movie_open', [ctypes.POINTER(_Movie), ctypes.c_char_p], ctypes.c_int)
+_movie_close = native('movie_close', [ctypes.POINTER(_Movie)], ctypes.c_int)
+
+_HASH = 1 << 15
+
+def palette(block=1, cmap='copper'):
+    """ RGB palette of the b^2 + 1 block magnetisations (at most 256), from a matplotlib colour map """
+    ncolors = min(block*block + 1, 256)
+    return np.ascontiguousarray(plt.get_cmap(cmap)(np.linspace(0, 1, ncolors))[:, :3] * 255 + 0.5,
+                                dtype=np.uint8)
+
+def _buffers(n, ncolors):
+    raw = np.empty(n*(n + 1), dtype=np.uint8)
+    out = np.empty(n*(n + 1)*9//8 + 3*ncolors + 1024, dtype=np.uint8)
+    return raw, out, np.empty(_HASH, dtype=np.int32)
+
+def _check(N, block):
+    if block < 1 or N % block:
+        raise ValueError("the lattice size must be a multiple of the block size")
+
+def render(config, block=1, cmap='copper'):
+    """ RGB image (N/block x N/block x 3, uint8) of a lattice, block averaged """
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    N = config.shape[0]
+    _check(N, block)
+    colors = palette(block, cmap)
+    pixels = np.empty((N // block, N // block), dtype=np.uint8)
+    _render_lattice(config, N, block, len(colors), pixels)
+    return colors[pixels]
+
+def png(config, block=1, cmap='copper'):
+    """ PNG file contents of a lattice, block averaged """
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    N = config.shape[0]
+    _check(N, block)
+    colors = palette(block, cmap)
+    raw, out, work = _buffers(N // block, len(colors))
+    size = _png_encode(config, N, block, colors, len(colors), raw, work, out)
+    return out[:size].tobytes()
+
+def save_png(path, config, block=1, cmap='copper'):
+    """ Write a lattice to a PNG file """
+    with open(path, 'wb') as f:
+        f.write(png(config, block, cmap))
+
+class Movie:
+    def __init__(self, path, N, frames, every=1, block=1, cmap='copper', fps=25):
+        """
+        Animated PNG recorded inside the sweep loop.
+
+        Parameters:
+        -----------
+        path : str
+            Output file (.png or .apng)
+        N : int
+            Size of the lattice (N x N), a multiple of block
+        frames : int
+            Maximum number of frames; measurements beyond it are ignored
+        every : int
+            Record a frame every this many production sweeps
+        block : int
+            Average over block x block spins per pixel
+        cmap : str
+            Matplotlib colour map
+        fps : int
+            Frames per second of playback
+
+        Example usage:
+
+        with Movie('quench.png', N=4096, frames=1000, every=10, block=4) as movie:
+            model.simulate(temperature=1.5, measure=[movie])
+        """
+        _check(N, block)
+        if frames < 1:
+            raise ValueError("a movie needs room for at least one frame")
+        self.path = path
+        self.N = N
+        self.every = every
+        n = N // block
+        self.palette = palette(block, cmap)
+        self.raw, self.out, self.work = _buffers(n, len(self.palette))
+        self._data = _Movie(None, block, n, len(self.palette), self.palette.ctypes.data, frames, 1, fps,
+                            self.raw.ctypes.data, self.out.ctypes.data, self.work.ctypes.data, 0, 0, 0)
+        if _movie_open(self._data, os.fsencode(path)) < 0:
+            raise OSError(f"cannot write {path}")
+
+    @property
+    def frames(self):
+        return self._data.frames
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("movie and lattice sizes differ")
+        if not self._data.file:
+            raise ValueError("the movie has been closed")
+        return Observer(OBS_MOVIE, self.every, ctypes.addressof(self._data))
+
+    def close(self):
+        """ Finish the file; returns the number of frames recorded (a movie without any holds one blank frame) """
+        if self._data.file and _movie_close(self._data) < 0:
+            raise OSError(f"writing {self.path} failed")
+        return self.frames
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        if hasattr(self, '_data'):
+            self.close()
@@ -0,0 +1,167 @@
+"""
+Jackknife and bootstrap errors of derived quantities from long E, M series.
+
+The series (typically the memory-mapped columns of a results.ResultCache
+run) are reduced to compensated block sums of |m|, m^2, m^4, e and e^2 by
+native code, split across threads; the resampling then only touches the
+blocks. The estimators come from a fixed menu (those of
+moments.estimates: e, m, c, chi, u4) and every call returns the
+estimates, their errors and their covariance, along with the replicates
+for anything derived further.
+
+Example usage:
+
+    run = ResultCache().run(32, 2.27, 1000, 10**7)
+    series = Series.from_result(run)
+    jk = jackknife(series, ['c', 'chi', 'u4'], blocks=256)
+    jk.values, jk.errors, jk.covariance
+    bs = bootstrap(series, ['u4'], samples=2000)
+"""
+import ctypes
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+from .core import native
+from .moments import COLUMNS, QUANTITIES, estimates
+
+_int64_p = np.ctypeslib.ndpointer(np.int64, flags='C_CONTIGUOUS')
+_double_p = np.ctypeslib.ndpointer(np.float64, flags='C_CONTIGUOUS')
+
+_block_moments = native('block_moments', [_int64_p, _int64_p, ctypes.c_longlong, ctypes.c_longlong,
+                                          ctypes.c_int, ctypes.c_double, _double_p])
+_bootstrap_means = native('bootstrap_means', [_double_p, _double_p, ctypes.c_int, ctypes.c_int, ctypes.c_uint64,
+                                              ctypes.c_longlong, ctypes.c_longlong, _double_p])
+
+class Series:
+    def __init__(self, E, M, N, beta):
+        """ Energy and magnetisation series (int64, may be memory-mapped) of an N x N run at beta """
+        self.E = np.asarray(E, dtype=np.int64)
+        self.M = np.asarray(M, dtype=np.int64)
+        if len(self.E) != len(self.M) or not len(self.E):
+            raise ValueError("E and M must be non-empty and of the same length")
+        self.N = N
+        self.beta = beta
+        self.e0 = self.E[0] / (N*N)
+
+    @classmethod
+    def from_result(cls, result, production=None):
+        """ The series of a stored run (results.Result), optionally its first `production` sweeps """
+        return cls(result.column('E', production), result.column('M', production),
+                   result.key['N'], 1.0/result.key['T'])
+
+    def __len__(self):
+        return len(self.E)
+
+    def blocks(self, blocks, threads=4):
+        """ Block sums of the moment columns and the number of samples in each block """
+        if blocks < 1:
+            raise ValueError("at least one block is needed")
+        count = len(self)
+        size = -(-count // blocks)
+        nblocks = -(-count // size)
+        sums = np.empty((nblocks, len(COLUMNS)))
+        # whole blocks per task, so that the split does not change the sums
+        per_task = -(-nblocks // threads)
+        def task(b):
+            first, last = b*size, min((b + per_task)*size, count)
+            out = np.empty((-(-(last - first) // size), len(COLUMNS)))
+            _block_moments(np.ascontiguousarray(self.E[first:last]), np.ascontiguousarray(self.M[first:last]),
+                           last - first, size, self.N, self.e0, out)
+            sums[b:b + len(out)] = out
+        with ThreadPoolExecutor(threads) as pool:
+            list(pool.map(task, range(0, nblocks, per_task)))
+        weights = np.full(nblocks, size, dtype=float)
+        weights[-1] = count - (nblocks - 1)*size
+        return sums, weights
+
+    def estimate(self, means, quantities):
+        est = estimates(means, self.e0, self.N, self.beta)
+        return np.stack([np.asarray(est[q], dtype=float) for q in quantities], axis=-1)
+
+class Estimate:
+    def __init__(self, quantities, values, replicates, covariance):
+        """ Estimates of quantities with their covariance and the replicates they came from """
+        self.quantities = list(quantities)
+        self.values = dict(zip(self.quantities, values))
+        self.errors = dict(zip(self.quantities, np.sqrt(np.diag(covariance))))
+        self.covariance = covariance
+        self.replicates = replicates
+
+    def __repr__(self):
+        return ', '.join(f"{q} = {self.values[q]:.6g} +/- {self.errors[q]:.2g}" for q in self.quantities)
+
+def _check(quantities):
+    quantities = list(quantities)
+    for q in quantities:
+        if q not in QUANTITIES:
+            raise ValueError(f"unknown estimator {q}; available: {QUANTITIES}")
+    return quantities
+
+def jackknife(series, quantities=QUANTITIES, blocks=128, threads=4):
+    """ Delete-one-block jackknife of the quantities; replicates are the leave-one-out estimates """
+    quantities = _check(quantities)
+    sums, weights = series.blocks(blocks, threads)
+    total, count = sums.sum(axis=0), weights.sum()
+    values = series.estimate(total / count, quantities)
+    B = len(weights)
+    if B < 2:
+        raise ValueError("the jackknife needs at least two blocks")
+    loo = series.estimate((total - sums) / (count - weights)[:, None], quantities)
+    d = loo - loo.mean(axis=0)
+    return Estimate(quantities, values, loo, (B - 1) / B * d.T @ d)
+
+def bootstrap_means(sums, weights, samples, seed=0, threads=4):
+    """ Column means of bootstrap replicates drawing len(weights) blocks with replacement, natively """
+    sums = np.ascontiguousarray(sums, dtype=float)
+    weights = np.ascontiguousarray(weights, dtype=float)
+    if samples < 1:
+        raise ValueError("the bootstrap needs at least one sample")
+    out = np.empty((samples, sums.shape[1]))
+    per_task = -(-samples // min(threads, samples))
+    def task(first):
+        last = min(first + per_task, samples)
+        part = np.empty((last - first, sums.shape[1]))
+        _bootstrap_means(sums, weights, len(weights), sums.shape[1], seed, first, last, part)
+        out[first:last] = part
+    with ThreadPoolExecutor(threads) as pool:
+        list(pool.map(task, range(0, samples, per_task)))
+    return out
+
+def bootstrap(series, quantities=QUANTITIES, blocks=128, samples=1000, seed=0, threads=4):
+    """ Block bootstrap of the quantities; replicates are the per-sample estimates """
+    quantities = _check(quantities)
+    sums, weights = series.blocks(blocks, threads)
+    values = series.estimate(sums.sum(axis=0) / weights.sum(), quantities)
+    replicates = series.estimate(bootstrap_means(sums, weights, samples, seed, threads), quantities)
+    return Estimate(quantities, values, replicates, np.atleast_2d(np.cov(replicates, rowvar=False)))
+
+def crossing(small, large, temperatures, quantity='u4', blocks=128, samples=1000, seed=0, threads=4):
+    """
+    Temperature where the curves of two lattice sizes cross, with its bootstrap error.
+
+    small and large are lists of Series at the given (increasing)
+    temperatures. Every run is resampled independently; replicates without
+    a crossing on the grid are dropped. Returns (T, error, replicates).
+    """
+    temperatures = np.asarray(temperatures, dtype=float)
+    def curve(runs, offset):
+        values, reps = [], []
+        for k, s in enumerate(runs):
+            b = bootstrap(s, [quantity], blocks, samples, seed + offset + k, threads)
+            values.append(b.values[quantity])
+            reps.append(b.replicates[:, 0])
+        return np.array(values), np.array(reps).T
+    a, ra = curve(small, 0)
+    b, rb = curve(large, len(small))
+
+    def cross(d):
+        # first sign change along each row, linearly interpolated
+        T = np.full(len(d), np.nan)
+        rows, cols = np.nonzero(np.sign(d[:, :-1]) * np.sign(d[:, 1:]) < 0)
+        rows, first = np.unique(rows, return_index=True)
+        j = cols[first]
+        T[rows] = temperatures[j] - d[rows, j] * (temperatures[j+1] - temperatures[j]) / (d[rows, j+1] - d[rows, j])
+        return T
+    replicates = cross(rb - ra)
+    replicates = replicates[np.isfinite(replicates)]
+    error = replicates.std(ddof=1) if len(replicates) > 1 else np.nan
+    return cross((b - a)[None])[0], error, replicates
@@ -0,0 +1,170 @@
+"""
+On-disk store of simulation results, keyed by everything that determines
+a run: model, N, T, equilibration sweeps, seed, algorithm and the version
+of the compiled library.
+
+Each run is a directory holding meta.json, the final configuration and one
+raw little-endian file per column of the production series (sweep, E, M),
+readable with memory mapping. The configuration file is named after the
+series length and referenced from meta.json, so that replacing meta.json
+commits both at once. The number of production sweeps is not part
+of the key: asking for fewer sweeps than stored reuses a prefix of the
+series, asking for more resumes the run from its final configuration and
+RNG state and appends to the columns.
+
+Example usage:
+
+    cache = ResultCache()
+    model = IsingModel(N=64, equilibration=1000, production=10000)
+    model.simulate(temperature=2.3, cache=cache)     # runs and stores
+    model.simulate(temperature=2.3, cache=cache)     # instant
+    model.production = 50000
+    model.simulate(temperature=2.3, cache=cache)     # runs 40000 more sweeps
+    model.results['u4']
+    values, errors = cache.get(64, 2.3, 1000).observables()
+"""
+import hashlib
+import json
+import os
+import numpy as np
+from . import core
+from .moments import Moments
+from .stream import TimeSeries
+
+COLUMNS = (('sweep', '<i8'), ('E', '<i8'), ('M', '<i8'))
+MODEL = 'ising2d-metropolis'
+
+_version = None
+
+def library_version():
+    """ Package version and a hash of the compiled library the runs use """
+    global _version
+    if _version is None:
+        digest = 'none'
+        if getattr(core, 'lib_path', None):
+            with open(core.lib_path, 'rb') as f:
+                digest = hashlib.sha1(f.read()).hexdigest()[:12]
+        _version = f"0.1.0+{digest}"
+    return _version
+
+class Result:
+    def __init__(self, path):
+        """ A stored run; columns are memory-mapped """
+        self.path = path
+        with open(os.path.join(path, 'meta.json')) as f:
+            self.meta = json.load(f)
+        self.key = self.meta['key']
+        self.length = self.meta['length']
+
+    def column(self, name, production=None):
+        """ Memory map of one column of the production series (the first `production` entries) """
+        dtype = dict(COLUMNS)[name]
+        length = self.length if production is None else min(production, self.length)
+        if length == 0:
+            return np.empty(0, dtype=dtype)
+        return np.memmap(os.path.join(self.path, name), dtype=dtype, mode='r', shape=(length,))
+
+    @property
+    def config(self):
+        """ Final configuration of the stored run """
+        return np.load(os.path.join(self.path, self.meta.get('config', 'config.npy'))).astype(np.int32)
+
+    def moments(self, production=None):
+        """ The moments accumulator (moments.Moments) of the first `production` sweeps """
+        return Moments.from_series(self.column('E', production), self.column('M', production),
+                                   self.key['N'], 1.0/self.key['T'])
+
+    def observables(self, production=None):
+        """ Values and jackknife errors of e, m, c, chi and u4, as IsingModel.simulate computes them """
+        return self.moments(production).results()
+
+class ResultCache:
+    def __init__(self, root=None, chunk=1 << 16):
+        """
+        Result store under root (default ~/.cache/compdismatter/results).
+        Production runs are recorded chunk sweeps at a time.
+        """
+        self.root = os.path.expanduser(root or os.path.join('~', '.cache', 'compdismatter', 'results'))
+        self.chunk = chunk
+
+    def key(self, N, temperature, equilibration, seed):
+        return {'model': MODEL, 'N': int(N), 'T': float(temperature), 'equilibration': int(equilibration),
+                'seed': int(seed), 'algorithm': 'native', 'version': library_version()}
+
+    def path(self, key):
+        digest = hashlib.sha1(json.dumps(key, sort_keys=True).encode()).hexdigest()[:20]
+        return os.path.join(self.root, digest)
+
+    def get(self, N, temperature, equilibration, seed=0):
+        """ The stored run, or None """
+        path = self.path(self.key(N, temperature, equilibration, seed))
+        return Result(path) if os.path.exists(os.path.join(path, 'meta.json')) else None
+
+    def runs(self):
+        """ All stored runs """
+        if not os.path.isdir(self.root):
+            return []
+        return [Result(os.path.join(self.root, d)) for d in sorted(os.listdir(self.root))
+                if os.path.exists(os.path.join(self.root, d, 'meta.json'))]
+
+    def run(self, N, temperature, equilibration, production, seed=0):
+        """ The run with at least `production` production sweeps, computing only what is missing """
+        if not core.has_kernels:
+            raise RuntimeError("cached runs require the native ising library")
+        key = self.key(N, temperature, equilibration, seed)
+        path = self.path(key)
+        meta_path = os.path.join(path, 'meta.json')
+        beta = 1.0/temperature
+
+        if os.path.exists(meta_path):
+            result = Result(path)
+            if result.length >= production:
+                return result
+            meta = result.meta
+            config = result.config
+            state = core.new_state(config, beta, 0)
+            state.rng = meta['rng']
+            state.sweep = meta['sweep']
+        else:
+            os.makedirs(path, exist_ok=True)
+            config, kernel_seed = core.random_start(N, seed)
+            state = core.new_state(config, beta, kernel_seed)
+            core.run(state, equilibration)
+            state.sweep = 0
+            meta = {'key': key, 'length': 0}
+
+        # the metadata is authoritative: drop anything appended by an interrupted run
+        for name, _ in COLUMNS:
+            with open(os.path.join(path, name), 'ab') as f:
+                f.truncate(meta['length'] * 8)
+        series = TimeSeries(min(self.chunk, production))
+        files = {name: open(os.path.join(path, name), 'ab') for name, _ in COLUMNS}
+        try:
+            remaining = production - meta['length']
+            while remaining > 0:
+                sweeps = min(self.chunk, remaining)
+                core.run(state, sweeps, [series])
+                for name, dtype in COLUMNS:
+                    getattr(series, name)[:len(series)].astype(dtype).tofile(files[name])
+                series._data.count = 0
+                remaining -= sweeps
+        finally:
+            for f in files.values():
+                f.close()
+
+        # a new file, so that a crash before meta.json is replaced leaves the
+        # old configuration next to the old length, sweep and RNG state
+        meta['config'] = f"config-{production}.npy"
+        np.save(os.path.join(path, meta['config']), config.astype(np.int8))
+        values, errors = Moments.from_series(np.fromfile(os.path.join(path, 'E'), '<i8'),
+                                             np.fromfile(os.path.join(path, 'M'), '<i8'), N, beta).results()
+        meta.update(length=production, sweep=state.sweep, rng=state.rng,
+                    summary={'values': {q: float(v) for q, v in values.items()},
+                             'errors': {q: float(v) for q, v in errors.items()}})
+        with open(meta_path + '.tmp', 'w') as f:
+            json.dump(meta, f, indent=1)
+        os.replace(meta_path + '.tmp', meta_path)
+        for name in os.listdir(path):
+            if name.startswith('config') and name.endswith('.npy') and name != meta['config']:
+                os.remove(os.path.join(path, name))
+        return Result(path)
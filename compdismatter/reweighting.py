@@ -0,0 +1,223 @@
+"""
+Ferrenberg-Swendsen histogram reweighting.
+
+An EnergyHistogram accumulated during `IsingModel.simulate` records H(E)
+together with the sums of |M|, M^2 and M^4 in every energy bin. Since the
+distribution of M at fixed E does not depend on temperature, this is all
+that is needed to reweight both energy and magnetisation observables to
+nearby temperatures. Several runs are combined with the multi-histogram
+(WHAM) equations; every sum is done in log space for stability.
+"""
+import ctypes
+import numpy as np
+from .core import Observer, OBS_ENERGY_HISTOGRAM, OBS_MAGNETISATION_HISTOGRAM
+
+class _EnergyHistogram(ctypes.Structure):
+    _fields_ = [('counts', ctypes.c_void_p),
+                ('m1', ctypes.c_void_p),
+                ('m2', ctypes.c_void_p),
+                ('m4', ctypes.c_void_p)]
+
+class EnergyHistogram:
+    def __init__(self, N, every=1):
+        """
+        Energy histogram with per-bin magnetisation moments.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        every : int
+            Measure every this many production sweeps
+
+        Example usage:
+
+        hist = EnergyHistogram(N=32)
+        model.simulate(temperature=2.27, measure=[hist])
+        curves = hist.reweight(np.linspace(2.1, 2.4, 100))
+        """
+        self.N = N
+        self.every = every
+        self.beta = None
+        nbins = N*N + 1
+        self.counts = np.zeros(nbins, dtype=np.int64)
+        self.m1 = np.zeros(nbins)
+        self.m2 = np.zeros(nbins)
+        self.m4 = np.zeros(nbins)
+
+    @property
+    def energies(self):
+        return 4*np.arange(self.N*self.N + 1) - 2*self.N*self.N
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("histogram and lattice sizes differ")
+        if self.beta is not None and self.beta != state.beta:
+            raise ValueError("a histogram can only accumulate runs at one temperature")
+        self.beta = state.beta
+        self._data = _EnergyHistogram(self.counts.ctypes.data, self.m1.ctypes.data,
+                                      self.m2.ctypes.data, self.m4.ctypes.data)
+        return Observer(OBS_ENERGY_HISTOGRAM, self.every, ctypes.addressof(self._data))
+
+    def merge(self, other):
+        """ Add the samples of another histogram taken at the same temperature """
+        if other.N != self.N or other.beta != self.beta:
+            raise ValueError("only histograms of the same size and temperature can be merged")
+        self.counts += other.counts
+        self.m1 += other.m1
+        self.m2 += other.m2
+        self.m4 += other.m4
+        return self
+
+    def distribution(self):
+        """ Energies per spin of the visited bins and their sampled probabilities P(e) """
+        visited = self.counts > 0
+        return self.energies[visited] / (self.N*self.N), self.counts[visited] / self.counts.sum()
+
+    def reweight(self, temperatures):
+        """ Single-histogram reweighting to the given temperatures """
+        return multi_histogram([self], temperatures)
+
+class MagnetisationHistogram:
+    def __init__(self, N, every=1):
+        """ Histogram of M over the production sweeps, one bin per allowed value """
+        self.N = N
+        self.every = every
+        self.beta = None
+        self.counts = np.zeros(N*N + 1, dtype=np.int64)
+        self._data = ctypes.c_void_p(self.counts.ctypes.data)
+
+    @property
+    def magnetisations(self):
+        return 2*np.arange(self.N*self.N + 1) - self.N*self.N
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("histogram and lattice sizes differ")
+        if self.beta is not None and self.beta != state.beta:
+            raise ValueError("a histogram can only accumulate runs at one temperature")
+        self.beta = state.beta
+        return Observer(OBS_MAGNETISATION_HISTOGRAM, self.every, ctypes.addressof(self._data))
+
+    def merge(self, other):
+        """ Add the samples of another histogram taken at the same temperature """
+        if other.N != self.N or other.beta != self.beta:
+            raise ValueError("only histograms of the same size and temperature can be merged")
+        self.counts += other.counts
+        return self
+
+    def distribution(self):
+        """ Magnetisations per spin of the visited bins and their sampled probabilities P(m) """
+        visited = self.counts > 0
+        return self.magnetisations[visited] / (self.N*self.N), self.counts[visited] / self.counts.sum()
+
+def combine(hists):
+    """
+    One histogram holding the samples of several (e.g. one per thread or
+    replica), all of the same class, size and temperature
+    """
+    hists = list(hists)
+    if not hists:
+        raise ValueError("no histograms to combine")
+    total = type(hists[0])(hists[0].N, hists[0].every)
+    total.beta = hists[0].beta
+    for h in hists:
+        total.merge(h)
+    return total
+
+def _logsumexp(a, axis=None):
+    amax = np.max(a, axis=axis, keepdims=True)
+    return np.squeeze(amax, axis=axis) + np.log(np.sum(np.exp(a - amax), axis=axis))
+
+def wham(H, bias, tol=1e-10, maxiter=100):
+    """
+    Solve the weighted histogram analysis equations.
+
+    H[r, b] counts visits of run r to bin b and bias[r, b] is the
+    dimensionless bias (in units of kT, +inf outside a hard window) under
+    which run r sampled. Returns the unbiased ln P(b), up to a constant, and
+    the free energies f_r = ln Z_r of the runs relative to the first one.
+
+    The equations are the stationarity conditions of a convex function of
+    the run free energies, minimised here by Newton's method, which unlike
+    the usual fixed-point iteration converges quickly for long chains of
+    windows.
+    """
+    n = H.sum(axis=1)
+    logn = np.log(n)[:, None]
+    Hb = H.sum(axis=0)
+    f = np.zeros(H.shape[0])
+
+    def objective(f):
+        logD = _logsumexp(logn + f[:, None] - bias, axis=0)
+        return np.dot(Hb, logD) - np.dot(n, f), logD
+
+    A, logD = objective(f)
+    for _ in range(maxiter):
+        w = np.exp(logn + f[:, None] - bias - logD) * Hb
+        grad = w.sum(axis=1) - n
+        if np.max(np.abs(grad / n)) < tol:
+            break
+        hess = np.diag(w.sum(axis=1)) - (w / np.where(Hb > 0, Hb, 1)) @ w.T
+        step = np.zeros_like(f)
+        step[1:] = np.linalg.lstsq(hess[1:, 1:], -grad[1:], rcond=None)[0]
+        t = 1.0
+        while True:
+            new, newlogD = objective(f + t*step)
+            if new <= A or t < 1e-8:
+                break
+            t /= 2
+        f, A, logD = f + t*step, new, newlogD
+
+    lnP = np.log(Hb) - logD
+    return lnP - lnP.max(), -f
+
+def density_of_states(hists, **kwargs):
+    """
+    Solve the multi-histogram equations for ln g(E).
+
+    Returns the visited energies, ln g(E) there (up to a constant) and the
+    free energies f = ln Z of the individual runs.
+    """
+    N = hists[0].N
+    if any(h.N != N for h in hists):
+        raise ValueError("all histograms must have the same lattice size")
+    counts = np.array([h.counts for h in hists], dtype=float)
+    visited = counts.sum(axis=0) > 0
+    E = hists[0].energies[visited].astype(float)
+    betas = np.array([h.beta for h in hists])[:, None]
+    lng, lnZ = wham(counts[:, visited], betas*E, **kwargs)
+    return E, lng, lnZ
+
+def multi_histogram(hists, temperatures, **kwargs):
+    """
+    Reweight one or more energy histograms to arbitrary temperatures.
+
+    Returns a dict of per-spin energy 'e', magnetisation 'm', specific heat
+    'c', susceptibility 'chi' and Binder cumulant 'u4', one entry per temperature.
+    """
+    N = hists[0].N
+    E, lng, _ = density_of_states(hists, **kwargs)
+    visited = np.sum([h.counts for h in hists], axis=0) > 0
+    H = np.sum([h.counts for h in hists], axis=0)[visited]
+    m1 = np.sum([h.m1 for h in hists], axis=0)[visited] / H
+    m2 = np.sum([h.m2 for h in hists], axis=0)[visited] / H
+    m4 = np.sum([h.m4 for h in hists], axis=0)[visited] / H
+
+    betas = 1.0/np.atleast_1d(np.asarray(temperatures, dtype=float))[:, None]
+    logw = lng - betas*E
+    w = np.exp(logw - logw.max(axis=1, keepdims=True))
+    w /= w.sum(axis=1, keepdims=True)
+
+    meanE = w @ E
+    varE = np.sum(w * (E - meanE[:, None])**2, axis=1)
+    M1, M2, M4 = w @ m1, w @ m2, w @ m4
+    b = betas.ravel()
+    n = N*N
+    return {
+        'e': meanE / n,
+        'm': M1 / n,
+        'c': b*b*varE / n,
+        'chi': b*(M2 - M1*M1) / n,
+        'u4': 1 - M4/(3*M2*M2),
+    }
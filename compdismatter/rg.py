@@ -0,0 +1,150 @@
+"""
+Majority-rule block-spin transformations and Monte Carlo renormalisation
+group (MCRG) estimates of the thermal and magnetic exponents.
+
+Blocking works on both the int32 and the bit-packed layouts and is also a
+fast way to downsample very large lattices for plotting. The MCRG
+observer blocks every measured configuration repeatedly inside the sweep
+loop and accumulates the correlations of a few even and odd operators at
+every level, from which the linearised RG transformation is solved
+(Swendsen's method).
+"""
+import ctypes
+import numpy as np
+from .core import native, Observer, OBS_MCRG
+from . import bitpack
+
+RG_OPERATORS = 5
+EVEN, ODD = slice(0, 3), slice(3, 5)
+
+_int_p = np.ctypeslib.ndpointer(np.int32, flags='C_CONTIGUOUS')
+_rng_p = ctypes.POINTER(ctypes.c_uint64)
+
+_block_spin = native('block_spin', [_int_p, ctypes.c_int, ctypes.c_int, _rng_p, _int_p])
+_block_spin_packed = native('block_spin_packed', [bitpack.packed_t, ctypes.c_int, ctypes.c_int, _rng_p,
+                                                  bitpack.packed_t])
+
+class _MCRG(ctypes.Structure):
+    _fields_ = [('b', ctypes.c_int),
+                ('levels', ctypes.c_int),
+                ('rng', ctypes.c_uint64),
+                ('work', ctypes.c_void_p),
+                ('mean', ctypes.c_void_p),
+                ('same', ctypes.c_void_p),
+                ('next', ctypes.c_void_p),
+                ('samples', ctypes.c_longlong)]
+
+def _tie_rng(seed):
+    """ Random tie breaking from a seed; None breaks ties by the top-left spin """
+    if seed is None:
+        return None
+    return ctypes.pointer(ctypes.c_uint64(int(np.random.default_rng(seed).integers(2**63))))
+
+def _check(N, b, levels):
+    if b < 2 or N % b**levels:
+        raise ValueError(f"N = {N} is not divisible by b^levels = {b}^{levels}")
+
+def block_spin(config, b=2, levels=1, seed=None):
+    """
+    Majority-rule block spins of an int32 lattice, applied `levels` times.
+    Ties are broken at random when a seed is given, else by the top-left
+    spin of the block.
+    """
+    config = np.ascontiguousarray(config, dtype=np.int32)
+    N = config.shape[0]
+    _check(N, b, levels)
+    rng = _tie_rng(seed)
+    for _ in range(levels):
+        N //= b
+        out = np.empty((N, N), dtype=np.int32)
+        _block_spin(config, N*b, b, rng, out)
+        config = out
+    return config
+
+def block_spin_packed(packed, N, b=2, levels=1, seed=None):
+    """ Majority-rule block spins of a bit-packed N x N lattice; returns the packed result """
+    if b > 64:
+        raise ValueError("packed blocking needs b <= 64")
+    _check(N, b, levels)
+    packed = np.ascontiguousarray(packed, dtype=np.uint64)
+    rng = _tie_rng(seed)
+    for _ in range(levels):
+        N //= b
+        out = np.empty((N, bitpack.words(N)), dtype=np.uint64)
+        _block_spin_packed(packed, N*b, b, rng, out)
+        packed = out
+    return packed
+
+def downsample(config, size):
+    """ Block an N x N lattice down to size x size (N a multiple of size) for display """
+    N = config.shape[0]
+    if N % size:
+        raise ValueError("the lattice size must be a multiple of the display size")
+    return block_spin(config, N // size) if N > size else config
+
+class MCRG:
+    def __init__(self, N, b=2, levels=3, every=1, seed=1234):
+        """
+        In-kernel Monte Carlo renormalisation group accumulator.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N), divisible by b^levels
+        b : int
+            Block size
+        levels : int
+            Number of blocking steps
+        every : int
+            Measure every this many production sweeps
+        seed : int
+            Seed of the random tie breaking (used when b is even)
+
+        Example usage:
+
+        rg = MCRG(N=256, b=2, levels=4, every=10)
+        model.simulate(temperature=2.269, measure=[rg])
+        yt, yh = rg.exponents()
+        """
+        _check(N, b, levels)
+        self.N = N
+        self.b = b
+        self.levels = levels
+        self.every = every
+        K = RG_OPERATORS
+        self.work = np.empty(sum((N // b**l)**2 for l in range(1, levels + 1)), dtype=np.int32)
+        self.mean = np.zeros((levels + 1, K))
+        self.same = np.zeros((levels + 1, K, K))
+        self.next = np.zeros((levels, K, K))
+        self._data = _MCRG(b, levels, int(np.random.default_rng(seed).integers(2**63)), self.work.ctypes.data,
+                           self.mean.ctypes.data, self.same.ctypes.data, self.next.ctypes.data, 0)
+
+    @property
+    def samples(self):
+        return self._data.samples
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("MCRG and lattice sizes differ")
+        return Observer(OBS_MCRG, self.every, ctypes.addressof(self._data))
+
+    def transformation(self, level, operators=EVEN):
+        """
+        Linearised RG matrix T = dK(l + 1) / dK(l) for blocking step l -> l + 1,
+        restricted to the given operators, from
+        <S(l + 1) S(l)>_c = <S(l + 1) S(l + 1)>_c T.
+        """
+        n = self.samples
+        mean = self.mean / n
+        upper, lower = mean[level + 1, operators], mean[level, operators]
+        A = self.next[level][operators, operators] / n - np.outer(upper, lower)
+        C = self.same[level + 1][operators, operators] / n - np.outer(upper, upper)
+        return np.linalg.solve(C, A)
+
+    def exponents(self):
+        """ Thermal and magnetic eigenvalue exponents y_t, y_h for each blocking step """
+        def leading(T):
+            return np.log(np.max(np.abs(np.linalg.eigvals(T)))) / np.log(self.b)
+        yt = np.array([leading(self.transformation(l, EVEN)) for l in range(self.levels)])
+        yh = np.array([leading(self.transformation(l, ODD)) for l in range(self.levels)])
+        return yt, yh
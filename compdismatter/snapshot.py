@@ -0,0 +1,204 @@
+"""
+Live views of a running simulation through a double-buffered snapshot.
+
+The native run loop renders the lattice (block averaged, as for movies)
+into the back buffer of a shared region and publishes it atomically, at
+most once per time interval, never waiting for readers. A viewer in
+another thread or process attaches to the region by name and copies the
+latest frame whenever it likes.
+
+Example usage:
+
+    # simulation process
+    live = SharedSnapshot(N=4096, block=4, interval=0.1)
+    model.simulate(temperature=1.5, measure=[live])
+
+    # viewer process
+    view = SnapshotReader(live.name)
+    sweep, E, M, frame = view.latest()
+    image = view.palette[frame]
+"""
+import ctypes
+import mmap
+import os
+import sys
+import time
+import numpy as np
+from multiprocessing import shared_memory
+from .core import native, Observer, OBS_SNAPSHOT
+from .render import palette
+
+class _Header(ctypes.Structure):
+    _fields_ = [('sequence', ctypes.c_uint64),
+                ('sweep', ctypes.c_int64 * 2),
+                ('E', ctypes.c_int64 * 2),
+                ('M', ctypes.c_int64 * 2),
+                ('n', ctypes.c_int32),
+                ('b', ctypes.c_int32),
+                ('ncolors', ctypes.c_int32),
+                ('reserved', ctypes.c_int32)]
+
+class _Snapshot(ctypes.Structure):
+    _fields_ = [('shared', ctypes.c_void_p),
+                ('interval', ctypes.c_double),
+                ('last', ctypes.c_double)]
+
+_snapshot_read = native('snapshot_read', [ctypes.c_void_p, np.ctypeslib.ndpointer(np.uint8, flags='C_CONTIGUOUS'),
+                                           np.ctypeslib.ndpointer(np.int64, flags='C_CONTIGUOUS')], ctypes.c_int)
+
+def _frames(buf, header):
+    n = header.n
+    return np.ndarray((2, n, n), dtype=np.uint8, buffer=buf, offset=ctypes.sizeof(_Header))
+
+class SharedSnapshot:
+    def __init__(self, N, block=1, interval=0.05, every=1, name=None, shared=True):
+        """
+        Writer side of a live snapshot.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N), a multiple of block
+        block : int
+            Average over block x block spins per pixel
+        interval : float
+            Minimum wall-clock seconds between published frames
+        every : int
+            Check whether a frame is due every this many sweeps
+        name : str
+            Name of the shared memory block (default: chosen by the system)
+        shared : bool
+            Use shared memory, visible to other processes; otherwise a
+            private buffer for viewers in the same process (e.g. pyodide)
+        """
+        if block < 1 or N % block:
+            raise ValueError("the lattice size must be a multiple of the block size")
+        self.N = N
+        self.every = every
+        n = N // block
+        size = ctypes.sizeof(_Header) + 2*n*n
+        if shared:
+            self._shm = shared_memory.SharedMemory(name=name, create=True, size=size)
+            self.name = self._shm.name
+            self.buffer = self._shm.buf
+        else:
+            self._shm = None
+            self.name = None
+            self.buffer = bytearray(size)
+        self.header = _Header.from_buffer(self.buffer)
+        self.header.n, self.header.b, self.header.ncolors = n, block, min(block*block + 1, 256)
+        self._data = _Snapshot(ctypes.addressof(self.header), interval, -np.inf)
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("snapshot and lattice sizes differ")
+        return Observer(OBS_SNAPSHOT, self.every, ctypes.addressof(self._data))
+
+    def reader(self):
+        """ A reader of this snapshot in the same process """
+        return SnapshotReader(buffer=self.buffer)
+
+    def close(self, unlink=True):
+        """ Release the shared memory (and remove it, unless other processes should keep it) """
+        if self._shm is not None:
+            del self.header
+            self.buffer = None
+            self._shm.close()
+            if unlink:
+                self._shm.unlink()
+            self._shm = None
+
+class _Mapping:
+    def __init__(self, name):
+        """
+        An existing POSIX shared memory block mapped from /dev/shm, like
+        SharedMemory(name) but without registering it with the resource
+        tracker (which would remove it when the reader exits)
+        """
+        name = name.lstrip('/')
+        if os.path.isdir('/dev/shm'):
+            fd = os.open(os.path.join('/dev/shm', name), os.O_RDWR)
+        else:
+            from multiprocessing import _posixshmem   # macOS has no /dev/shm
+            fd = _posixshmem.shm_open('/' + name, os.O_RDWR, mode=0o600)
+        try:
+            self._mmap = mmap.mmap(fd, os.fstat(fd).st_size)
+        finally:
+            os.close(fd)
+        self.buf = memoryview(self._mmap)
+
+    def close(self):
+        self.buf.release()
+        self._mmap.close()
+
+def _attach(name):
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name=name, track=False)
+    if os.name == 'nt':
+        return shared_memory.SharedMemory(name=name)   # no resource tracker on Windows
+    return _Mapping(name)
+
+class SnapshotReader:
+    def __init__(self, name=None, buffer=None, cmap='copper'):
+        """ Viewer side of a live snapshot, attached by shared memory name (or to a local buffer) """
+        if buffer is None:
+            self._shm = _attach(name)
+            buffer = self._shm.buf
+        else:
+            self._shm = None
+        self.header = _Header.from_buffer(buffer)
+        self.frames = _frames(buffer, self.header)
+        self.palette = palette(self.header.b, cmap)
+        self.sequence = 0
+
+    def latest(self, retries=100):
+        """
+        Copy of the most recently published frame as (sweep, E, M, indices),
+        or None if nothing has been published yet. Never blocks the writer;
+        retries if the writer published another frame during the copy.
+        """
+        h = self.header
+        n = h.n
+        frame = np.empty((n, n), dtype=np.uint8)
+        meta = np.empty(4, dtype=np.int64)
+        for _ in range(retries):
+            if h.sequence == 0:
+                return None
+            if _snapshot_read(ctypes.addressof(h), frame, meta):
+                self.sequence = int(meta[0])
+                return int(meta[1]), int(meta[2]), int(meta[3]), frame
+        return None
+
+    def image(self):
+        """ RGB image of the latest frame, or None """
+        latest = self.latest()
+        return None if latest is None else self.palette[latest[3]]
+
+    def updated(self):
+        """ Whether a newer frame than the last one read has been published """
+        return self.header.sequence > self.sequence
+
+    def watch(self, period=0.1, duration=None):
+        """ Show the frames live with matplotlib until the window is closed (or duration has passed) """
+        import matplotlib.pyplot as plt
+        fig, ax = plt.subplots(figsize=(5, 5))
+        ax.axis('off')
+        shown = None
+        start = time.monotonic()
+        while plt.fignum_exists(fig.number) and (duration is None or time.monotonic() - start < duration):
+            latest = self.latest() if self.updated() else None
+            if latest is not None:
+                sweep, E, M, frame = latest
+                if shown is None:
+                    shown = ax.imshow(self.palette[frame], interpolation='nearest')
+                else:
+                    shown.set_data(self.palette[frame])
+                ax.set_title(f"sweep {sweep}")
+            plt.pause(period)
+
+    def close(self):
+        if self._shm is not None:
+            del self.header
+            self.frames = None
+            self._shm.close()
+            self._shm = None
@@ -0,0 +1,206 @@
+"""
+Non-blocking simulations: the native sweep loop runs in a background
+thread (ctypes releases the GIL) while the caller consumes the energy and
+magnetisation series batch by batch, with a plain or an `async for` loop.
+
+Batches go through a bounded queue, so a slow consumer holds the
+simulation back instead of letting memory grow, and progress callbacks
+are rate limited in wall-clock time.
+"""
+import asyncio
+import ctypes
+import queue
+import threading
+import time
+import numpy as np
+from .core import new_state, run, Observer, OBS_SERIES
+
+class _TimeSeries(ctypes.Structure):
+    _fields_ = [('sweep', ctypes.c_void_p),
+                ('E', ctypes.c_void_p),
+                ('M', ctypes.c_void_p),
+                ('capacity', ctypes.c_longlong),
+                ('count', ctypes.c_longlong)]
+
+class TimeSeries:
+    def __init__(self, capacity, every=1):
+        """ Sweep, E and M recorded every `every` sweeps, up to capacity samples """
+        self.every = every
+        self.sweep = np.zeros(capacity, dtype=np.int64)
+        self.E = np.zeros(capacity, dtype=np.int64)
+        self.M = np.zeros(capacity, dtype=np.int64)
+        self._data = _TimeSeries(self.sweep.ctypes.data, self.E.ctypes.data, self.M.ctypes.data, capacity, 0)
+
+    def __len__(self):
+        return self._data.count
+
+    def observer(self, state):
+        return Observer(OBS_SERIES, self.every, ctypes.addressof(self._data))
+
+    def take(self, n):
+        """ Per-spin arrays of the samples so far, then start again from empty """
+        k = self._data.count
+        block = {'sweep': self.sweep[:k].copy(), 'e': self.E[:k] / n, 'm': self.M[:k] / n}
+        self._data.count = 0
+        return block
+
+_DONE = object()
+
+class Simulation:
+    def __init__(self, config, temperature, equilibration, production, measure=(), every=1,
+                 batch=1000, maxsize=16, progress=None, progress_interval=0.5, seed=None):
+        """
+        A simulation running in a background thread.
+
+        Parameters:
+        -----------
+        config : array
+            Initial N x N int32 lattice, updated in place
+        temperature : float
+            Temperature of the simulation
+        equilibration, production : int
+            Sweeps before and during the measurements
+        measure : list
+            In-kernel measurements accumulated every production sweep
+        every : int
+            Record e and m every this many production sweeps
+        batch : int
+            Production sweeps per batch handed to the consumer
+        maxsize : int
+            Batches buffered before the simulation waits for the consumer
+        progress : callable
+            progress(sweeps_done, sweeps_total), called from the background
+            thread at most once per progress_interval seconds and at the end
+
+        Example usage:
+
+        sim = model.start(temperature=2.3, batch=500)
+        for block in sim:
+            print(block['sweep'][-1], block['e'].mean())
+
+        async for block in model.start(temperature=2.3):
+            ...
+        """
+        if seed is None:
+            seed = np.random.randint(2**63, dtype=np.uint64)
+        self.config = config
+        self.N = config.shape[0]
+        self.state = new_state(config, 1.0/temperature, seed)
+        self.equilibration = equilibration
+        self.production = production
+        self.measure = list(measure)
+        self.batch = batch
+        self.series = TimeSeries(-(-batch // every), every)
+        self.progress = progress
+        self.progress_interval = progress_interval
+        self.error = None
+        self.poll_interval = 0.01
+        self._ended = False
+        self._queue = queue.Queue(maxsize)
+        self._cancel = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def _report(self, done, last, final=False):
+        now = time.monotonic()
+        if self.progress and (final or now - last >= self.progress_interval):
+            self.progress(done, self.equilibration + self.production)
+            return now
+        return last
+
+    def _put(self, item):
+        """ Hand an item to the consumer; False if cancelled while waiting for room """
+        while not self._cancel.is_set():
+            try:
+                self._queue.put(item, timeout=0.1)
+                return True
+            except queue.Full:
+                pass
+        return False
+
+    def _run(self):
+        n = self.N*self.N
+        last = -np.inf
+        try:
+            done = 0
+            while done < self.equilibration and not self._cancel.is_set():
+                sweeps = min(self.batch, self.equilibration - done)
+                run(self.state, sweeps)
+                done += sweeps
+                last = self._report(done, last)
+            self.state.sweep = 0
+            measure = self.measure + [self.series]
+            done = 0
+            while done < self.production and not self._cancel.is_set():
+                sweeps = min(self.batch, self.production - done)
+                run(self.state, sweeps, measure)
+                done += sweeps
+                if not self._put(self.series.take(n)):
+                    break
+                last = self._report(self.equilibration + done, last)
+            self._report(self.equilibration + done, last, final=True)
+        except Exception as e:
+            self.error = e
+        finally:
+            # the end marker always gets through; a cancelled run may drop a batch for it
+            while True:
+                try:
+                    self._queue.put_nowait(_DONE)
+                    break
+                except queue.Full:
+                    if self._put(_DONE):
+                        break
+                # cancelled while the queue is full
+                try:
+                    self._queue.get_nowait()
+                except queue.Empty:
+                    pass
+
+    def cancel(self):
+        """ Stop after the current batch """
+        self._cancel.set()
+
+    def done(self):
+        return not self._thread.is_alive()
+
+    def join(self, timeout=None):
+        """ Wait for the run to finish (draining any batches not consumed) """
+        for _ in self:
+            pass
+        self._thread.join(timeout)
+        return self
+
+    def _unpack(self, item):
+        if item is _DONE:
+            self._ended = True
+            if self.error is not None:
+                raise self.error
+            raise StopIteration
+        return item
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        if self._ended:
+            raise StopIteration
+        return self._unpack(self._queue.get())
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        if self._ended:
+            raise StopAsyncIteration
+        # poll rather than block a helper thread in get(), which would be
+        # left waiting (and could swallow a batch) if the task is cancelled
+        while True:
+            try:
+                item = self._queue.get_nowait()
+                break
+            except queue.Empty:
+                await asyncio.sleep(self.poll_interval)
+        try:
+            return self._unpack(item)
+        except StopIteration:
+            raise StopAsyncIteration
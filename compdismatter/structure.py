@@ -0,0 +1,166 @@
+"""
+Structure factor S(k), spin-spin correlation function G(r) and the
+second-moment correlation length of lattice configurations.
+
+S(k) is accumulated on the half plane of wavevectors, either snapshot by
+snapshot or inside the sweep loop, with a native FFT plan built once per
+lattice size. Radial averages use shells of width 2 pi / N. Lattice sizes
+that are not powers of two fall back to numpy's FFT for snapshots.
+"""
+import ctypes
+import numpy as np
+from .core import native, Observer, OBS_STRUCTURE_FACTOR
+
+_double_p = np.ctypeslib.ndpointer(np.float64, flags='C_CONTIGUOUS')
+_int_p = np.ctypeslib.ndpointer(np.int32, flags='C_CONTIGUOUS')
+
+class _FFTPlan(ctypes.Structure):
+    _fields_ = [('N', ctypes.c_int),
+                ('nbins', ctypes.c_int),
+                ('twiddle', ctypes.c_void_p),
+                ('bitrev', ctypes.c_void_p),
+                ('bins', ctypes.c_void_p),
+                ('weights', ctypes.c_void_p),
+                ('counts', ctypes.c_void_p),
+                ('buffer', ctypes.c_void_p),
+                ('scratch', ctypes.c_void_p),
+                ('field', ctypes.c_void_p)]
+
+class _StructureFactor(ctypes.Structure):
+    _fields_ = [('plan', ctypes.POINTER(_FFTPlan)),
+                ('power', ctypes.c_void_p),
+                ('samples', ctypes.c_longlong)]
+
+_plan_p = ctypes.POINTER(_FFTPlan)
+_structure_factor_add = native('structure_factor_add', [_plan_p, _int_p, _double_p])
+_correlation_function = native('correlation_function', [_plan_p, _double_p, _double_p])
+_radial_average = native('radial_average', [_plan_p, _double_p, _double_p])
+
+class FFTPlan:
+    def __init__(self, N):
+        """
+        Everything needed to transform N x N lattices: twiddle factors,
+        bit reversal, radial shells and work buffers.
+        """
+        self.N = N
+        self.native = N >= 2 and N & (N - 1) == 0
+        H = N//2 + 1
+        ky = np.fft.fftfreq(N, 1.0/N)[:, None]
+        kx = np.arange(H)[None, :]
+        shell = np.rint(np.sqrt(kx**2 + ky**2)).astype(np.int32)
+        self.nbins = N//2 + 1
+        self.bins = np.where(shell < self.nbins, shell, -1).astype(np.int32)
+        self.weights = np.where((kx == 0) | (2*kx == N), 1.0, 2.0) * np.ones((N, 1))
+        self.counts = np.bincount(self.bins[self.bins >= 0], self.weights[self.bins >= 0], self.nbins)
+        # shell radii in units of the lattice spacing, wavevectors in units of 2 pi / N
+        self.r = np.arange(self.nbins)
+        self.k = 2*np.pi*self.r / N
+        if not self.native:
+            return
+
+        t = np.arange(N//2)
+        self.twiddle = np.column_stack([np.cos(2*np.pi*t/N), -np.sin(2*np.pi*t/N)]).ravel()
+        bits = N.bit_length() - 1
+        self.bitrev = np.array([int(format(i, f'0{bits}b')[::-1], 2) for i in range(N)], dtype=np.int32)
+        self.buffer = np.empty(2*N*H)
+        self.scratch = np.empty(2*N)
+        self.field = np.empty(N*N)
+        self.plan = _FFTPlan(N, self.nbins, *(a.ctypes.data for a in (
+            self.twiddle, self.bitrev, self.bins, self.weights, self.counts, self.buffer, self.scratch, self.field)))
+
+    def radial(self, half):
+        """ Shell averages of a half-plane array """
+        if self.native:
+            out = np.empty(self.nbins)
+            _radial_average(self.plan, np.ascontiguousarray(half, dtype=float), out)
+            return out
+        valid = self.bins >= 0
+        return np.bincount(self.bins[valid], (self.weights*half)[valid], self.nbins) / self.counts
+
+class StructureFactor:
+    def __init__(self, N, every=1, plan=None):
+        """
+        Streaming structure-factor accumulator.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        every : int
+            Measure every this many production sweeps when used in `simulate`
+        plan : FFTPlan
+            Plan to share with other accumulators of the same size
+
+        Example usage:
+
+        sf = StructureFactor(N=256, every=10)
+        model.simulate(temperature=2.3, measure=[sf])
+        k, S = sf.k, sf.radial()
+        r, G = sf.r, sf.correlation()
+        xi = sf.correlation_length()
+        """
+        self.N = N
+        self.every = every
+        self.plan = plan or FFTPlan(N)
+        self.power = np.zeros((N, N//2 + 1))
+        self._data = _StructureFactor(ctypes.pointer(self.plan.plan) if self.plan.native else None,
+                                      self.power.ctypes.data, 0)
+
+    @property
+    def samples(self):
+        return self._data.samples
+
+    @property
+    def k(self):
+        return self.plan.k
+
+    @property
+    def r(self):
+        return self.plan.r
+
+    def add(self, config):
+        """ Accumulate the structure factor of one snapshot """
+        config = np.ascontiguousarray(config, dtype=np.int32)
+        if self.plan.native:
+            _structure_factor_add(self.plan.plan, config, self.power)
+        else:
+            self.power += np.abs(np.fft.rfft2(config))**2 / (self.N*self.N)
+        self._data.samples += 1
+
+    def observer(self, state):
+        if state.N != self.N:
+            raise ValueError("structure factor and lattice sizes differ")
+        if not self.plan.native:
+            raise ValueError("in-kernel structure factors need N to be a power of two")
+        return Observer(OBS_STRUCTURE_FACTOR, self.every, ctypes.addressof(self._data))
+
+    def mean(self):
+        """ Mean S(k) on the half plane kx = 0 .. N/2 """
+        return self.power / self.samples
+
+    def radial(self):
+        """ Radially averaged S(k) on shells k = 2 pi n / N """
+        return self.plan.radial(self.mean())
+
+    def correlation(self, connected=False):
+        """
+        Radially averaged G(r) = <s_0 s_r>; connected subtracts <s>^2,
+        estimated from S(0) = <M^2> / N^2 as <M^2> / N^4.
+        """
+        mean = self.mean()
+        if self.plan.native:
+            half = np.empty_like(mean)
+            _correlation_function(self.plan.plan, mean, half)
+        else:
+            half = np.fft.irfft2(mean, s=(self.N, self.N))[:, :self.N//2 + 1]
+        G = self.plan.radial(half)
+        if connected:
+            G = G - mean[0, 0] / (self.N*self.N)
+        return G
+
+    def correlation_length(self):
+        """ Second-moment correlation length from S(0) and S(k_min), k_min = 2 pi / N """
+        mean = self.mean()
+        S0 = mean[0, 0]
+        Smin = 0.5*(mean[0, 1] + mean[1, 0])
+        return np.sqrt(max(S0/Smin - 1, 0.0)) / (2*np.sin(np.pi/self.N))
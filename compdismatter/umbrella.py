@@ -0,0 +1,89 @@
+"""
+Umbrella sampling of the free energy F(M) as a function of magnetisation,
+e.g. for the nucleation barrier of the Ising model in a field.
+
+Each window confines M to an interval (optionally with a harmonic spring
+towards its centre); windows run concurrently and their magnetisation
+histograms are combined with WHAM.
+"""
+import ctypes
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+from .core import native, new_state, State, Observer
+from .reweighting import MagnetisationHistogram, wham
+
+_umbrella_run = native('umbrella_run', [ctypes.POINTER(State), ctypes.c_longlong, ctypes.c_double,
+                                        ctypes.c_int, ctypes.c_int, ctypes.c_double, ctypes.c_double,
+                                        ctypes.POINTER(Observer), ctypes.c_int])
+
+class UmbrellaSampling:
+    def __init__(self, N, temperature, windows, spring=0.0, field=0.0, threads=4, seed=1234):
+        """
+        Umbrella sampling in M for the N x N Ising model.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        temperature : float
+            Temperature of the simulation
+        windows : list of (int, int)
+            Magnetisation intervals [lo, hi]; neighbouring windows should overlap
+        spring : float
+            Strength of the harmonic bias spring/2 (M - centre)^2, in units of kT
+        field : float
+            External magnetic field h
+        threads : int
+            Worker threads sharing the windows
+
+        Example usage:
+
+        edges = np.linspace(-256, 256, 17).astype(int)
+        us = UmbrellaSampling(16, 1.5, list(zip(edges[:-1] - 8, edges[1:] + 8)), field=0.05)
+        M, F = us.run(10000)
+        """
+        self.N = N
+        self.beta = 1.0/temperature
+        self.spring = spring
+        self.field = field
+        self.threads = threads
+        n = N*N
+        # M takes the values -n, -n + 2, ..., n
+        self.windows = [(max(-n, lo + (lo + n) % 2), min(n, hi - (hi + n) % 2)) for lo, hi in windows]
+
+        rng = np.random.default_rng(seed)
+        self.configs, self.states = [], []
+        for lo, hi in self.windows:
+            up = (n + (lo + hi)//2 + n % 2) // 2
+            config = -np.ones(n, dtype=np.int32)
+            config[rng.permutation(n)[:up]] = 1
+            config = config.reshape(N, N)
+            self.configs.append(config)
+            self.states.append(new_state(config, self.beta, int(rng.integers(2**63))))
+        self.hists = [MagnetisationHistogram(N) for _ in self.windows]
+
+    def _run_window(self, k, nsweeps, measure):
+        lo, hi = self.windows[k]
+        observers = (Observer * 1)(self.hists[k].observer(self.states[k])) if measure else None
+        _umbrella_run(self.states[k], nsweeps, self.field, lo, hi, self.spring, 0.5*(lo + hi),
+                      observers, 1 if measure else 0)
+
+    def bias(self):
+        """ Dimensionless bias of every window at every M, +inf outside the window """
+        M = self.hists[0].magnetisations
+        bias = np.full((len(self.windows), len(M)), np.inf)
+        for k, (lo, hi) in enumerate(self.windows):
+            inside = (M >= lo) & (M <= hi)
+            bias[k, inside] = 0.5*self.spring*(M[inside] - 0.5*(lo + hi))**2
+        return bias
+
+    def run(self, nsweeps, equilibration=1000):
+        """ Sample every window; returns the visited M and F(M) in units of kT """
+        with ThreadPoolExecutor(self.threads) as pool:
+            list(pool.map(lambda k: self._run_window(k, equilibration, False), range(len(self.windows))))
+            list(pool.map(lambda k: self._run_window(k, nsweeps, True), range(len(self.windows))))
+        H = np.array([h.counts for h in self.hists], dtype=float)
+        visited = H.sum(axis=0) > 0
+        lnP, self.f = wham(H[:, visited], self.bias()[:, visited])
+        M = self.hists[0].magnetisations[visited]
+        return M, -(lnP - lnP.max())
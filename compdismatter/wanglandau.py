@@ -0,0 +1,191 @@
+"""
+Wang-Landau estimation of the density of states g(E), followed by a
+multicanonical production run with the converged weights.
+
+The energy range can be split into overlapping windows that are sampled
+concurrently (the native walk releases the GIL), with replica exchange
+between neighbouring windows after every batch of sweeps.
+"""
+import ctypes
+from concurrent.futures import ThreadPoolExecutor
+import numpy as np
+from .core import native, new_state, State, Observer
+from .reweighting import EnergyHistogram
+
+_double_p = np.ctypeslib.ndpointer(np.float64, flags='C_CONTIGUOUS')
+_long_p = np.ctypeslib.ndpointer(np.int64, flags='C_CONTIGUOUS')
+
+_wang_landau_run = native('wang_landau_run', [ctypes.POINTER(State), ctypes.c_longlong, _double_p,
+                                              _long_p, ctypes.c_int, ctypes.c_int, ctypes.c_double])
+_muca_run = native('muca_run', [ctypes.POINTER(State), ctypes.c_longlong, _double_p,
+                                ctypes.POINTER(Observer), ctypes.c_int])
+
+class _Window:
+    def __init__(self, N, lo, hi, seed):
+        self.lo, self.hi = lo, hi
+        self.lng = np.zeros(N*N + 1)
+        self.hist = np.zeros(N*N + 1, dtype=np.int64)
+        self.visited = np.zeros(N*N + 1, dtype=bool)
+        self.lnf = 1.0
+        rng = np.random.default_rng(seed)
+        self.config = (2*rng.integers(2, size=(N, N)) - 1).astype(np.int32)
+        self.state = new_state(self.config, 0.0, int(rng.integers(2**63)))
+
+    def bin(self, N):
+        return (self.state.E + 2*N*N) // 4
+
+    def run(self, nsweeps):
+        _wang_landau_run(self.state, nsweeps, self.lng, self.hist, self.lo, self.hi, self.lnf)
+
+class WangLandau:
+    def __init__(self, N, windows=1, overlap=0.5, flatness=0.8, lnf_final=1e-8,
+                 sweeps_per_check=100, threads=None, seed=1234):
+        """
+        Wang-Landau sampler for the N x N Ising model.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        windows : int
+            Number of overlapping energy windows sampled in parallel
+        overlap : float
+            Fraction of a window shared with each neighbour
+        flatness : float
+            A histogram is flat when min(H) > flatness * mean(H)
+        lnf_final : float
+            Stop once the modification factor ln f falls below this
+        sweeps_per_check : int
+            Sweeps between flatness checks and replica exchanges
+        threads : int
+            Worker threads (default: one per window)
+
+        Example usage:
+
+        wl = WangLandau(N=16, windows=4)
+        E, lng = wl.run()
+        hist = wl.production(10000)
+        curves = wl.canonical(np.linspace(1.5, 3.5, 100))
+        """
+        self.N = N
+        self.flatness = flatness
+        self.lnf_final = lnf_final
+        self.sweeps_per_check = sweeps_per_check
+        self.threads = threads or windows
+        self.rng = np.random.default_rng(seed)
+
+        # windows of equal width in energy bins, neighbours sharing a fraction overlap
+        nbins = N*N + 1
+        width = nbins / (windows - (windows - 1)*overlap)
+        lows = [int(round(k*width*(1 - overlap))) for k in range(windows)]
+        highs = [min(nbins, int(round(lo + width))) - 1 for lo in lows]
+        highs[-1] = nbins - 1
+        self.windows = [_Window(N, lo, hi, int(self.rng.integers(2**63)))
+                        for lo, hi in zip(lows, highs)]
+        self.lng = None
+        self.hist = None
+
+    def _flat(self, w):
+        H = w.hist[w.visited]
+        return len(H) > 0 and H.min() > self.flatness * H.mean()
+
+    def _exchange(self, a, b):
+        """ Replica exchange between neighbouring windows a and b """
+        N = self.N
+        ia, ib = a.bin(N), b.bin(N)
+        if not (b.lo <= ia <= b.hi and a.lo <= ib <= a.hi):
+            return
+        logp = a.lng[ia] - a.lng[ib] + b.lng[ib] - b.lng[ia]
+        if logp >= 0 or self.rng.random() < np.exp(logp):
+            config = a.config.copy()
+            a.config[...] = b.config
+            b.config[...] = config
+            a.state.E, b.state.E = b.state.E, a.state.E
+            a.state.M, b.state.M = b.state.M, a.state.M
+
+    def run(self):
+        """ Iterate until every window has converged; returns (E, ln g(E)) over the visited energies """
+        active = list(self.windows)
+        with ThreadPoolExecutor(self.threads) as pool:
+            while active:
+                list(pool.map(lambda w: w.run(self.sweeps_per_check), active))
+                for w in active:
+                    w.visited |= w.hist > 0
+                    if self._flat(w):
+                        w.hist[:] = 0
+                        w.lnf /= 2
+                active = [w for w in active if w.lnf >= self.lnf_final]
+                for a, b in zip(self.windows[:-1], self.windows[1:]):
+                    if a in active and b in active:
+                        self._exchange(a, b)
+        self.lng = self._join()
+        visited = np.isfinite(self.lng)
+        return self.energies[visited], self.lng[visited]
+
+    def _join(self):
+        """ Stitch the windows together by matching ln g over their overlaps """
+        lng = np.full(self.N*self.N + 1, -np.inf)
+        first = self.windows[0]
+        lng[first.visited] = first.lng[first.visited]
+        for w in self.windows[1:]:
+            known = np.isfinite(lng)
+            common = known & w.visited
+            shift = np.mean(lng[common] - w.lng[common]) if common.any() else 0.0
+            new = w.visited & ~known
+            lng[new] = w.lng[new] + shift
+        return lng - lng[np.isfinite(lng)].min()
+
+    @property
+    def energies(self):
+        return 4*np.arange(self.N*self.N + 1) - 2*self.N*self.N
+
+    def production(self, nsweeps, every=1):
+        """
+        Multicanonical run with weights 1/g(E); returns the EnergyHistogram
+        of the run and refines ln g(E) from it.
+        """
+        if self.lng is None:
+            self.run()
+        visited = np.isfinite(self.lng)
+        weights = np.where(visited, self.lng, self.lng[visited].max())
+        w = self.windows[0]
+        hist = EnergyHistogram(self.N, every)
+        observers = (Observer * 1)(hist.observer(w.state))
+        _muca_run(w.state, nsweeps, weights, observers, 1)
+        sampled = hist.counts > 0
+        refined = np.full_like(self.lng, -np.inf)
+        refined[sampled] = np.log(hist.counts[sampled]) + weights[sampled]
+        self.lng = refined - refined[sampled].min()
+        self.hist = hist
+        return hist
+
+    def microcanonical(self):
+        """ Entropy, inverse temperature and magnetisation moments as functions of E """
+        visited = np.isfinite(self.lng)
+        E = self.energies[visited]
+        S = self.lng[visited]
+        result = {'E': E, 'S': S, 'beta': np.gradient(S, E)}
+        if self.hist is not None:
+            H = np.maximum(self.hist.counts[visited], 1)
+            result['m1'] = self.hist.m1[visited] / H
+            result['m2'] = self.hist.m2[visited] / H
+            result['m4'] = self.hist.m4[visited] / H
+        return result
+
+    def canonical(self, temperatures):
+        """ Per-spin e, c (and m, chi, u4 after a production run) at the given temperatures """
+        micro = self.microcanonical()
+        E, S = micro['E'].astype(float), micro['S']
+        betas = 1.0/np.atleast_1d(np.asarray(temperatures, dtype=float))[:, None]
+        logw = S - betas*E
+        w = np.exp(logw - logw.max(axis=1, keepdims=True))
+        w /= w.sum(axis=1, keepdims=True)
+        meanE = w @ E
+        varE = np.sum(w * (E - meanE[:, None])**2, axis=1)
+        b = betas.ravel()
+        n = self.N*self.N
+        result = {'e': meanE / n, 'c': b*b*varE / n}
+        if 'm1' in micro:
+            M1, M2, M4 = w @ micro['m1'], w @ micro['m2'], w @ micro['m4']
+            result.update(m=M1 / n, chi=b*(M2 - M1*M1) / n, u4=1 - M4/(3*M2*M2))
+        return result
@@ -0,0 +1,47 @@
+#include <math.h>
+#include <string.h>
+#include "ising.h"
+
+// Two-time spin autocorrelation for aging. References are kept bit-packed,
+// so the overlap with the current lattice is a popcount of XORed words:
+// C(t, t_w) = 1 - 2 (spins that differ) / N^2.
+
+static double packed_overlap(const uint64_t *a, const uint64_t *b, long words, int N) {
+    long long differ = 0;
+    for (long w = 0; w < words; ++w) differ += bp_popcount(a[w] ^ b[w]);
+    return 1.0 - 2.0 * differ / ((double)N * N);
+}
+
+void measure_aging(aging *a, const ising_state *st) {
+    int N = st->N, packed = 0;
+    long words = (long)N * bp_words(N);
+
+    // references due now; those already passed are marked missed
+    while (a->stored < a->nwaiting && a->waiting[a->stored] <= st->sweep) {
+        if (a->waiting[a->stored] == st->sweep) {
+            if (!packed) {
+                pack_lattice(st->lattice, a->current, N);
+                packed = 1;
+            }
+            memcpy(a->refs + a->stored * words, a->current, words * sizeof(uint64_t));
+            a->taken[a->stored] = st->sweep;
+        } else {
+            a->taken[a->stored] = -1;
+        }
+        a->stored++;
+    }
+
+    while (a->next < a->nschedule && a->schedule[a->next] < st->sweep) {
+        double *row = a->table + (long)a->next * a->nwaiting;
+        for (int k = 0; k < a->nwaiting; ++k) row[k] = NAN;
+        a->next++;
+    }
+    if (a->next < a->nschedule && a->schedule[a->next] == st->sweep) {
+        double *row = a->table + (long)a->next * a->nwaiting;
+        if (!packed) pack_lattice(st->lattice, a->current, N);
+        for (int k = 0; k < a->nwaiting; ++k)
+            row[k] = k < a->stored && a->taken[k] >= 0
+                ? packed_overlap(a->refs + k * words, a->current, words, N) : NAN;
+        a->next++;
+    }
+}
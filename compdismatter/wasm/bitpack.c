@@ -0,0 +1,44 @@
+#include "ising.h"
+
+void pack_lattice(const int *lattice, uint64_t *packed, int N) {
+    int W = bp_words(N);
+    for (int i = 0; i < N; ++i) {
+        uint64_t *row = packed + (long)i * W;
+        for (int w = 0; w < W; ++w) row[w] = 0;
+        for (int j = 0; j < N; ++j) {
+            if (lattice[(long)i*N + j] > 0) row[j >> 6] |= 1ULL << (j & 63);
+        }
+    }
+}
+
+void unpack_lattice(const uint64_t *packed, int *lattice, int N) {
+    int W = bp_words(N);
+    for (int i = 0; i < N; ++i) {
+        const uint64_t *row = packed + (long)i * W;
+        for (int j = 0; j < N; ++j) {
+            lattice[(long)i*N + j] = (row[j >> 6] >> (j & 63)) & 1 ? 1 : -1;
+        }
+    }
+}
+
+// E = -sum over bonds s_i s_j = 2 * (unsatisfied bonds) - 2 N^2
+long long packed_energy(const uint64_t *packed, int N) {
+    int W = bp_words(N);
+    long long unequal = 0;
+    for (int i = 0; i < N; ++i) {
+        const uint64_t *row = packed + (long)i * W;
+        const uint64_t *down = packed + (long)((i+1) % N) * W;
+        for (int w = 0; w < W; ++w) {
+            unequal += bp_popcount(row[w] ^ bp_right(row, w, W, N));
+            unequal += bp_popcount(row[w] ^ down[w]);
+        }
+    }
+    return 2 * unequal - 2LL * N * N;
+}
+
+long long packed_magnetisation(const uint64_t *packed, int N) {
+    long long up = 0;
+    long nwords = (long)N * bp_words(N);
+    for (long w = 0; w < nwords; ++w) up += bp_popcount(packed[w]);
+    return 2 * up - (long long)N * N;
+}
@@ -0,0 +1,129 @@
+// Main-thread side of worker.js: starts the worker, speaks its message
+// protocol and reads frames from the shared buffer without blocking it.
+//
+//   const sim = new IsingWorker('compdismatter/wasm/worker.js');
+//   await sim.init({wasm: 'compdismatter/wasm/ising-shared.wasm', N: 512, temperature: 2.0});
+//   sim.onframe = () => draw(sim.latest());
+//   sim.start({batch: 5, interval: 40});
+//   sim.set({temperature: 1.5});
+//   await sim.stop();
+
+const isNode = typeof process !== 'undefined' && !!(process.versions && process.versions.node)
+    && typeof window === 'undefined';
+
+const FRAME_META = 16;
+const frameOffset = () => FRAME_META + 6 * 8;
+const frameBytes = (N) => frameOffset() + 2 * N * N;
+
+class IsingWorker {
+    constructor(url = 'worker.js') {
+        this.onframe = null;
+        this.onerror = (message) => { throw new Error(message); };
+        this.frame = null;
+        this._waiting = {};
+        this._running = null;
+        if (isNode) {
+            const {Worker} = require('worker_threads');
+            this.worker = new Worker(url);
+            this.worker.on('message', (m) => this._receive(m));
+        } else {
+            this.worker = new Worker(url);
+            this.worker.onmessage = (e) => this._receive(e.data);
+        }
+    }
+
+    _receive(msg) {
+        if (msg.type === 'frame') {
+            if (msg.lattice) this.frame = msg;
+            if (this.onframe) this.onframe(msg);
+        } else if (msg.type === 'error') {
+            const waiting = Object.values(this._waiting);
+            this._waiting = {};
+            if (waiting.length) waiting.forEach(({reject}) => reject(new Error(msg.message)));
+            else this.onerror(msg.message);
+            return;
+        }
+        const waiting = this._waiting[msg.type];
+        if (waiting) {
+            delete this._waiting[msg.type];
+            waiting.resolve(msg);
+        }
+    }
+
+    _expect(type) {
+        return new Promise((resolve, reject) => { this._waiting[type] = {resolve, reject}; });
+    }
+
+    _post(msg) {
+        this.worker.postMessage(msg);
+    }
+
+    // Frames go through shared memory when SharedArrayBuffer is available
+    // (in browsers, only on cross-origin isolated pages), else by message.
+    // With ising-shared.wasm the kernels themselves run in that memory.
+    async init({wasm, N, temperature = 2.269, seed = Date.now(), shared = true}) {
+        this.N = N;
+        shared = shared && typeof SharedArrayBuffer !== 'undefined';
+        const ready = this._expect('ready');
+        this._post({type: 'init', wasm, N, temperature, seed, shared});
+        const msg = await ready;
+        this.shared = msg.buffer || null;
+        this.framesBase = msg.frames || 0;
+        this.latticeBase = msg.lattice;
+        return msg;
+    }
+
+    // Resolves with the final {sweep, E, M} once the run has stopped
+    start({sweeps = Infinity, batch = 10, interval = 50} = {}) {
+        if (!this._running) {
+            this._running = this._expect('stopped').finally(() => { this._running = null; });
+            this._post({type: 'start', sweeps, batch, interval});
+        }
+        return this._running;
+    }
+
+    stop() {
+        this._post({type: 'stop'});
+        return this._running || Promise.resolve(null);
+    }
+
+    set(params) {
+        this._post({type: 'set', ...params});
+    }
+
+    // Latest frame as {sequence, sweep, E, M, lattice (Int8Array copy)}, or
+    // null before the first one. The copy is kept only if no other frame was
+    // published meanwhile: after publishing, the worker's next frame goes
+    // into the buffer being copied. Otherwise it retries.
+    latest() {
+        if (!this.shared) return this.frame;
+        const base = this.framesBase;
+        const header = new Int32Array(this.shared, base, 2);
+        const meta = new Float64Array(this.shared, base + FRAME_META, 6);
+        const size = this.N * this.N;
+        for (let attempt = 0; attempt < 100; ++attempt) {
+            const sequence = Atomics.load(header, 0);
+            if (sequence === 0) return null;
+            const front = sequence & 1;
+            const lattice = new Int8Array(this.shared, base + frameOffset() + front * size, size).slice();
+            const [sweep, E, M] = meta.slice(3 * front, 3 * front + 3);
+            if (Atomics.load(header, 0) === sequence) return {sequence, sweep, E, M, lattice};
+        }
+        return null;
+    }
+
+    // The lattice being swept, as an Int32Array over the worker's memory (no
+    // copy), or null unless the kernels run in shared memory. It may change
+    // while it is read; latest() gives whole frames.
+    live() {
+        if (this.latticeBase == null) return null;
+        return new Int32Array(this.shared, this.latticeBase, this.N * this.N);
+    }
+
+    terminate() {
+        return this.worker.terminate();
+    }
+}
+
+if (isNode) module.exports = {IsingWorker, frameBytes};
+else globalThis.IsingWorker = IsingWorker;
@@ -0,0 +1,26 @@
+#include "ising.h"
+
+// Size of the largest nearest-neighbour cluster of sites equal to spin,
+// with periodic boundaries. work holds 2 N^2 ints.
+int largest_cluster(const int *lattice, int N, int spin, int *work) {
+    int n = N * N;
+    int *parent = work, *size = work + n;
+    for (int k = 0; k < n; ++k) {
+        parent[k] = k;
+        size[k] = 1;
+    }
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            int k = i * N + j;
+            if (lattice[k] != spin) continue;
+            int right = i * N + (j+1) % N, down = ((i+1) % N) * N + j;
+            if (lattice[right] == spin) uf_union(parent, size, k, right);
+            if (lattice[down] == spin) uf_union(parent, size, k, down);
+        }
+    }
+    int largest = 0;
+    for (int k = 0; k < n; ++k) {
+        if (lattice[k] == spin && parent[k] == k && size[k] > largest) largest = size[k];
+    }
+    return largest;
+}
@@ -0,0 +1,63 @@
+#include <math.h>
+#include "ising.h"
+
+// Length scales of a coarsening configuration, measured at the scheduled
+// sweeps from inside the run loop. The energy comes from the incrementally
+// tracked E; G(r) and S(k) from one FFT of the lattice.
+
+// Row for the current configuration. A domain of linear size L has about
+// 2 L broken bonds per L^2 spins, each costing 2, so e - e_eq ~ 4 / L.
+static void coarsening_row(coarsening *c, const ising_state *st, double *row) {
+    const fft_plan *p = c->plan;
+    int N = st->N, nbins = p->nbins;
+    long half = (long)N * (N/2 + 1);
+    double n = (double)N * N;
+    row[0] = (double)st->sweep;
+    row[1] = st->E / n;
+    row[2] = st->M / n;
+    row[3] = row[1] > c->e_eq ? 4.0 / (row[1] - c->e_eq) : INFINITY;
+
+    for (long k = 0; k < half; ++k) c->power[k] = 0;
+    structure_factor_add(p, st->lattice, c->power);
+
+    // moments of S(k) over the modes with k > 0
+    radial_average(p, c->power, c->radial);
+    double s0 = 0, s1 = 0, s2 = 0;
+    for (int b = 1; b < nbins; ++b) {
+        double k = 2 * M_PI * b / N, w = p->counts[b] * c->radial[b];
+        s0 += w;
+        s1 += w * k;
+        s2 += w * k * k;
+    }
+    row[5] = s0 > 0 ? s1 / s0 : NAN;
+    row[6] = s0 > 0 ? s2 / s0 : NAN;
+    row[7] = s1 > 0 ? 2 * M_PI / row[5] : INFINITY;
+
+    // first zero of the radially averaged connected G(r), interpolated linearly
+    correlation_function(p, c->power, c->corr);
+    radial_average(p, c->corr, c->radial);
+    double m2 = row[2] * row[2];
+    row[4] = NAN;
+    for (int b = 1; b < nbins; ++b) {
+        double g0 = c->radial[b-1] - m2, g1 = c->radial[b] - m2;
+        if (g1 <= 0) {
+            row[4] = b - 1 + g0 / (g0 - g1);
+            break;
+        }
+    }
+}
+
+// Fill the next row when the sweep count reaches the next scheduled
+// entry; entries already passed are left as NaN rows
+void measure_coarsening(coarsening *c, const ising_state *st) {
+    while (c->next < c->nschedule && c->schedule[c->next] < st->sweep) {
+        double *row = c->table + (long)c->next * COARSENING_COLUMNS;
+        row[0] = (double)c->schedule[c->next];
+        for (int j = 1; j < COARSENING_COLUMNS; ++j) row[j] = NAN;
+        c->next++;
+    }
+    if (c->next < c->nschedule && c->schedule[c->next] == st->sweep) {
+        coarsening_row(c, st, c->table + (long)c->next * COARSENING_COLUMNS);
+        c->next++;
+    }
+}
@@ -0,0 +1,52 @@
+#include <string.h>
+#include "ising.h"
+
+// Forward flux sampling in the size of the largest cluster of `spin`,
+// with Metropolis dynamics in a field h. The order parameter is checked
+// after every sweep.
+
+static inline void field_sweep(ising_state *st, double h) {
+    long long n = (long long)st->N * st->N;
+    umbrella_run(st, 1, h, (int)-n, (int)n, 0.0, 0.0, NULL, 0);
+}
+
+// Run from the current configuration until the order parameter reaches
+// next (returns 1) or falls below lambdaA (returns 0); -1 after maxsweeps.
+int ffs_trial(ising_state *st, double h, int spin, int lambdaA, int next, long long maxsweeps, int *work) {
+    for (long long t = 0; t < maxsweeps; ++t) {
+        field_sweep(st, h);
+        int lambda = largest_cluster(st->lattice, st->N, spin, work);
+        if (lambda >= next) return 1;
+        if (lambda < lambdaA) return 0;
+    }
+    return -1;
+}
+
+// Count crossings of lambda0 by trajectories coming from the basin
+// (lambda < lambdaA), storing the first maxstore crossing configurations
+// bit-packed in store. A trajectory that reaches lambdaB is restarted from
+// reset.
+long long ffs_flux(ising_state *st, double h, int spin, int lambdaA, int lambda0, int lambdaB,
+                   long long nsweeps, const int *reset, uint64_t *store, int maxstore, int *nstored, int *work) {
+    int N = st->N;
+    long words = (long)N * bp_words(N);
+    long long crossings = 0;
+    int inA = 1;
+    for (long long t = 0; t < nsweeps; ++t) {
+        field_sweep(st, h);
+        int lambda = largest_cluster(st->lattice, N, spin, work);
+        if (lambda < lambdaA) {
+            inA = 1;
+        } else if (inA && lambda >= lambda0) {
+            crossings++;
+            inA = 0;
+            if (*nstored < maxstore) pack_lattice(st->lattice, store + (*nstored)++ * words, N);
+        }
+        if (lambda >= lambdaB) {
+            memcpy(st->lattice, reset, (size_t) N * N * sizeof(int));
+            state_init(st);
+            inA = 1;
+        }
+    }
+    return crossings;
+}
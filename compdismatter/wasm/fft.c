@@ -0,0 +1,106 @@
+#include <string.h>
+#include "ising.h"
+
+// Radix-2 FFTs for structure factors of N x N lattices (N a power of two).
+// Real 2D transforms keep the half plane kx = 0 .. N/2: rows are
+// transformed two at a time as the real and imaginary parts of one complex
+// FFT, then the N/2 + 1 columns. Everything a transform needs lives in the
+// plan, which the caller allocates once and reuses across snapshots.
+
+static void fft_complex(const fft_plan *p, double *z) {
+    int N = p->N;
+    for (int i = 0; i < N; ++i) {
+        int j = p->bitrev[i];
+        if (i < j) {
+            double re = z[2*i], im = z[2*i+1];
+            z[2*i] = z[2*j];
+            z[2*i+1] = z[2*j+1];
+            z[2*j] = re;
+            z[2*j+1] = im;
+        }
+    }
+    for (int len = 2; len <= N; len <<= 1) {
+        int half = len / 2, step = N / len;
+        for (int i = 0; i < N; i += len) {
+            for (int k = 0; k < half; ++k) {
+                double wr = p->twiddle[2*k*step], wi = p->twiddle[2*k*step+1];
+                double *a = z + 2*(i+k), *b = z + 2*(i+k+half);
+                double br = b[0]*wr - b[1]*wi, bi = b[0]*wi + b[1]*wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+
+// Transform a real field, given either as an int lattice or as doubles,
+// into p->buffer (N rows of N/2 + 1 complex numbers)
+static void fft_real2d(const fft_plan *p, const int *lattice, const double *field) {
+    int N = p->N, H = N/2 + 1;
+    double *z = p->scratch, *out = p->buffer;
+    for (int r = 0; r < N; r += 2) {
+        for (int j = 0; j < N; ++j) {
+            long a = (long)r*N + j, b = a + N;
+            z[2*j] = lattice ? lattice[a] : field[a];
+            z[2*j+1] = lattice ? lattice[b] : field[b];
+        }
+        fft_complex(p, z);
+        for (int k = 0; k < H; ++k) {
+            int m = (N - k) % N;
+            double zr = z[2*k], zi = z[2*k+1], cr = z[2*m], ci = -z[2*m+1];
+            double *xa = out + 2*((long)r*H + k), *xb = xa + 2*H;
+            xa[0] = 0.5 * (zr + cr);
+            xa[1] = 0.5 * (zi + ci);
+            xb[0] = 0.5 * (zi - ci);
+            xb[1] = -0.5 * (zr - cr);
+        }
+    }
+    for (int k = 0; k < H; ++k) {
+        for (int r = 0; r < N; ++r) memcpy(z + 2*r, out + 2*((long)r*H + k), 2 * sizeof(double));
+        fft_complex(p, z);
+        for (int r = 0; r < N; ++r) memcpy(out + 2*((long)r*H + k), z + 2*r, 2 * sizeof(double));
+    }
+}
+
+// Add S(k) = |sum_x s_x exp(-i k x)|^2 / N^2 of the lattice to power (half plane)
+void structure_factor_add(const fft_plan *p, const int *lattice, double *power) {
+    int N = p->N;
+    long half = (long)N * (N/2 + 1);
+    double norm = 1.0 / ((double)N * N);
+    fft_real2d(p, lattice, NULL);
+    for (long k = 0; k < half; ++k) {
+        double re = p->buffer[2*k], im = p->buffer[2*k+1];
+        power[k] += (re*re + im*im) * norm;
+    }
+}
+
+// G(r) = (1/N^2) sum_k S(k) exp(i k r) on the half plane. S is real and
+// even, so the forward transform gives the inverse one.
+void correlation_function(const fft_plan *p, const double *power, double *corr) {
+    int N = p->N, H = N/2 + 1;
+    for (int r = 0; r < N; ++r) {
+        for (int c = 0; c < N; ++c) {
+            p->field[(long)r*N + c] = c < H ? power[(long)r*H + c] : power[(long)((N - r) % N)*H + N - c];
+        }
+    }
+    fft_real2d(p, NULL, p->field);
+    double norm = 1.0 / ((double)N * N);
+    for (long k = 0; k < (long)N * H; ++k) corr[k] = p->buffer[2*k] * norm;
+}
+
+// Radial shell averages of a half-plane quantity
+void radial_average(const fft_plan *p, const double *half, double *out) {
+    long size = (long)p->N * (p->N/2 + 1);
+    for (int b = 0; b < p->nbins; ++b) out[b] = 0;
+    for (long k = 0; k < size; ++k) {
+        if (p->bins[k] >= 0) out[p->bins[k]] += p->weights[k] * half[k];
+    }
+    for (int b = 0; b < p->nbins; ++b) out[b] /= p->counts[b];
+}
+
+void measure_structure_factor(structure_factor *sf, const ising_state *st) {
+    structure_factor_add(sf->plan, st->lattice, sf->power);
+    sf->samples++;
+}
@@ -0,0 +1,26 @@
+#include <math.h>
+#include "ising.h"
+
+void measure_energy_histogram(energy_histogram *h, const ising_state *st) {
+    long long N2 = (long long)st->N * st->N;
+    long long bin = (st->E + 2 * N2) / 4;
+    double m = (double) st->M;
+    double m2 = m * m;
+    h->counts[bin]++;
+    h->m1[bin] += fabs(m);
+    h->m2[bin] += m2;
+    h->m4[bin] += m2 * m2;
+}
+
+void measure_magnetisation_histogram(magnetisation_histogram *h, const ising_state *st) {
+    long long N2 = (long long)st->N * st->N;
+    h->counts[(st->M + N2) / 2]++;
+}
+
+void measure_series(time_series *ts, const ising_state *st) {
+    if (ts->count == ts->capacity) return;
+    ts->sweep[ts->count] = st->sweep;
+    ts->E[ts->count] = st->E;
+    ts->M[ts->count] = st->M;
+    ts->count++;
+}
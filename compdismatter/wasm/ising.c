@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include "ising.h"
 
 void mcmove(int *lattice, int N, double beta) {
     for (int k = 0; k < N*N; ++k) {
@@ -19,3 +20,89 @@ void mcmove(int *lattice, int N, double beta) {
         }
     }
 }
+
+long long ising_energy(const int *lattice, int N) {
+    long long energy = 0;
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            int s = lattice[i*N + j];
+            energy -= s * (lattice[((i+1)%N)*N + j] + lattice[i*N + (j+1)%N]);
+        }
+    }
+    return energy;
+}
+
+long long ising_magnetisation(const int *lattice, int N) {
+    long long mag = 0;
+    for (int k = 0; k < N*N; ++k) mag += lattice[k];
+    return mag;
+}
+
+void state_init(ising_state *st) {
+    st->E = ising_energy(st->lattice, st->N);
+    st->M = ising_magnetisation(st->lattice, st->N);
+}
+
+void run_observers(observer *obs, int nobs, const ising_state *st) {
+    for (int k = 0; k < nobs; ++k) {
+        if (st->sweep % obs[k].every) continue;
+        switch (obs[k].kind) {
+        case OBS_ENERGY_HISTOGRAM:
+            measure_energy_histogram(obs[k].data, st);
+            break;
+        case OBS_MAGNETISATION_HISTOGRAM:
+            measure_magnetisation_histogram(obs[k].data, st);
+            break;
+        case OBS_SERIES:
+            measure_series(obs[k].data, st);
+            break;
+        case OBS_MOMENTS:
+            measure_moments(obs[k].data, st);
+            break;
+        case OBS_AGING:
+            measure_aging(obs[k].data, st);
+            break;
+        case OBS_STRUCTURE_FACTOR:
+            measure_structure_factor(obs[k].data, st);
+            break;
+        case OBS_COARSENING:
+            measure_coarsening(obs[k].data, st);
+            break;
+        case OBS_MCRG:
+            measure_mcrg(obs[k].data, st);
+            break;
+        case OBS_MOVIE:
+            measure_movie(obs[k].data, st);
+            break;
+        case OBS_SNAPSHOT:
+            measure_snapshot(obs[k].data, st);
+            break;
+        }
+    }
+}
+
+// Metropolis sweeps of N^2 random-site attempts, like mcmove, but with a
+// per-state RNG, a precomputed acceptance table and E, M kept up to date
+void metropolis_run(ising_state *st, long long nsweeps, observer *obs, int nobs) {
+    int N = st->N;
+    int *lattice = st->lattice;
+    double acc[3] = {1.0, exp(-4 * st->beta), exp(-8 * st->beta)};
+    for (long long t = 0; t < nsweeps; ++t) {
+        for (int k = 0; k < N*N; ++k) {
+            int i = rng_below(&st->rng, N);
+            int j = rng_below(&st->rng, N);
+            int idx = i * N + j;
+            int s = lattice[idx];
+            int sum = lattice[((i+1)%N)*N + j] + lattice[i*N + (j+1)%N]
+                    + lattice[((i-1+N)%N)*N + j] + lattice[i*N + ((j-1+N)%N)];
+            int cost = 2 * s * sum;
+            if (cost <= 0 || rng_uniform(&st->rng) < acc[cost >> 2]) {
+                lattice[idx] = -s;
+                st->E += cost;
+                st->M -= 2 * s;
+            }
+        }
+        st->sweep++;
+        if (nobs) run_observers(obs, nobs, st);
+    }
+}
@@ -0,0 +1,402 @@
+#ifndef ISING_H
+#define ISING_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// splitmix64: one 64-bit word of state, cheap enough to give every
+// lattice (or thread) its own stream
+static inline uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline double rng_uniform(uint64_t *state) {
+    return (rng_next(state) >> 11) * 0x1.0p-53;
+}
+
+static inline int rng_below(uint64_t *state, int n) {
+    return (int)(((rng_next(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+// Neumaier's variant of Kahan summation: the low-order bits lost by s + x
+// are collected in c, whichever of the two is larger
+static inline void neumaier_add(double *s, double *c, double x) {
+    double t = *s + x;
+    if (fabs(*s) >= fabs(x)) *c += (*s - t) + x;
+    else *c += (x - t) + *s;
+    *s = t;
+}
+
+typedef struct {
+    int *lattice;
+    int N;
+    double beta;
+    uint64_t rng;
+    long long sweep;    // sweeps done so far
+    long long E, M;     // tracked incrementally by the run loop
+} ising_state;
+
+// In-kernel measurements: the run loop calls every observer each `every`
+// sweeps, dispatching on kind to the measurement that owns `data`.
+enum {
+    OBS_ENERGY_HISTOGRAM = 1,
+    OBS_MAGNETISATION_HISTOGRAM,
+    OBS_STRUCTURE_FACTOR,
+    OBS_COARSENING,
+    OBS_MCRG,
+    OBS_MOVIE,
+    OBS_SNAPSHOT,
+    OBS_SERIES,
+    OBS_MOMENTS,
+    OBS_AGING,
+};
+
+typedef struct {
+    int kind;
+    int every;
+    void *data;
+} observer;
+
+// Histogram of E, indexed by (E + 2 N^2) / 4, with the sums of |M|, M^2
+// and M^4 over the samples in each energy bin
+typedef struct {
+    long long *counts;
+    double *m1, *m2, *m4;
+} energy_histogram;
+
+// Histogram of M, indexed by (M + N^2) / 2
+typedef struct {
+    long long *counts;
+} magnetisation_histogram;
+
+// Sweep, E and M at every measurement, up to capacity samples
+typedef struct {
+    long long *sweep, *E, *M;
+    long long capacity;
+    long long count;
+} time_series;
+
+// Per-spin |m|, m^2, m^4, e - e0 and (e - e0)^2 summed with compensation
+// into nblocks (even) jackknife blocks of block_size samples; when they are
+// full, pairs are merged and block_size doubles. e0 is the first sample, so
+// that the variance of e is not a small difference of large sums.
+enum { MOMENTS = 5 };
+
+typedef struct {
+    int nblocks;
+    long long block_size;
+    long long count;
+    double e0;
+    double *sum;        // nblocks x MOMENTS
+    double *comp;       // compensation of each sum
+} moments;
+
+// FFT plan for N x N lattices, N a power of two; half-plane arrays have
+// N rows of N/2 + 1 entries (kx = 0 .. N/2)
+typedef struct {
+    int N;
+    int nbins;
+    const double *twiddle;  // cos, sin of -2 pi k / N for k < N/2
+    const int *bitrev;
+    const int *bins;        // radial shell of each half-plane entry, -1 outside
+    const double *weights;  // 2 for entries standing in for -kx as well, else 1
+    const double *counts;   // total weight in each shell
+    double *buffer;         // half plane of complex numbers
+    double *scratch;        // N complex numbers
+    double *field;          // N x N reals
+} fft_plan;
+
+// Running sum of the half-plane structure factor over samples
+typedef struct {
+    const fft_plan *plan;
+    double *power;
+    long long samples;
+} structure_factor;
+
+// Coarsening tracker: at each sweep listed in schedule (increasing) one
+// row of COARSENING_COLUMNS is written to table: sweep, e, m, the length
+// 4 / (e - e_eq) from the excess energy, the first zero of the connected
+// G(r), <k> and <k^2> of S(k) over k > 0, and 2 pi / <k>
+enum { COARSENING_COLUMNS = 8 };
+
+typedef struct {
+    const fft_plan *plan;
+    const long long *schedule;
+    int nschedule;
+    int next;           // rows written so far
+    double e_eq;        // equilibrium energy per spin at the quench temperature
+    double *table;
+    double *power;      // half-plane work arrays
+    double *corr;
+    double *radial;     // nbins
+} coarsening;
+
+// Monte Carlo renormalisation group: block-spin levels 0 .. levels with
+// RG_OPERATORS operators each (three even, then two odd). Sums of the
+// operators, of their products within a level and of the products of
+// level l + 1 with level l are accumulated over samples.
+enum { RG_OPERATORS = 5 };
+
+typedef struct {
+    int b;
+    int levels;
+    uint64_t rng;       // tie breaks
+    int *work;          // blocked lattices of levels 1 .. levels, back to back
+    double *mean;       // (levels + 1) x RG_OPERATORS
+    double *same;       // (levels + 1) x RG_OPERATORS^2
+    double *next;       // levels x RG_OPERATORS^2, [a][c] = S_a(l + 1) S_c(l)
+    long long samples;
+} mcrg;
+
+// Animated PNG of the run: every measurement renders the lattice, block
+// averaged over b x b, to palette indices and appends one frame to file
+typedef struct {
+    FILE *file;         // opened by movie_open
+    int b, n;           // block size and frame size n = N / b
+    int ncolors;
+    const uint8_t *palette;
+    int nframes;        // frames announced; later measurements are ignored
+    int delay_num, delay_den;
+    uint8_t *raw;       // n (n + 1) scanline bytes
+    uint8_t *out;       // encoded chunks
+    int *work;          // 1 << 15 hash heads
+    int frames;
+    int sequence;
+    long actl;          // file offset of the acTL chunk
+    int error;          // set once a write has failed
+} movie;
+
+// Double-buffered snapshot in memory shared with a viewer. The header is
+// followed by two frames of n x n palette indices (as rendered for movies).
+// The writer fills frame (sequence + 1) & 1, then publishes it by storing
+// the new sequence with release order, and only then starts on the next
+// frame, which goes into the buffer just read from. A reader loads sequence
+// with acquire order, copies frame sequence & 1 and keeps the copy only if
+// sequence is unchanged afterwards (snapshot_read).
+typedef struct {
+    uint64_t sequence;      // frames published so far
+    int64_t sweep[2];       // sweep, E and M of each frame
+    int64_t E[2];
+    int64_t M[2];
+    int32_t n, b, ncolors, reserved;
+} snapshot_header;
+
+typedef struct {
+    snapshot_header *shared;
+    double interval;        // minimum wall-clock seconds between frames
+    double last;
+} snapshot;
+
+// Aging: the lattice is stored bit-packed at each waiting time t_w, and at
+// each scheduled sweep t one row of table holds C(t, t_w) for every
+// reference (NaN for references not yet taken or missed)
+typedef struct {
+    const long long *waiting;   // increasing t_w
+    int nwaiting;
+    int stored;                 // references due so far
+    long long *taken;           // sweep each reference was taken at, -1 if missed
+    const long long *schedule;  // increasing measurement sweeps
+    int nschedule;
+    int next;                   // rows written so far
+    uint64_t *refs;             // nwaiting packed lattices, N bp_words(N) words each
+    uint64_t *current;          // packed current lattice
+    double *table;              // nschedule x nwaiting
+} aging;
+
+enum { KCM_FA = 0, KCM_EAST = 1 };
+
+// Kinetically constrained model: occupation lattice, facilitated sets and
+// persistence field, all in caller-provided arrays
+typedef struct {
+    int *lattice;       // n_i in {0, 1}
+    int N;
+    int model;
+    int f;              // FA: excited neighbours needed
+    double c;           // equilibrium density of excitations
+    double time;
+    uint64_t rng;
+    int *members;       // facilitated sites: [0, N^2) unexcited, [N^2, 2 N^2) excited
+    int *where;         // position of each site in members, -1 if not facilitated
+    int count[2];
+    int *persistent;    // 1 until the site first flips
+    long long npersistent;
+} kcm_state;
+
+// Bit-packed lattice layout: row-major, (N + 63) / 64 words per row,
+// bit j % 64 of word j / 64 set when the spin at column j is +1.
+// Padding bits beyond column N-1 are always zero.
+
+static inline int bp_words(int N) { return (N + 63) / 64; }
+
+static inline uint64_t bp_lastmask(int N) {
+    int nlast = N - 64 * (bp_words(N) - 1);
+    return nlast == 64 ? ~0ULL : (1ULL << nlast) - 1;
+}
+
+// Word w of the row shifted so that each bit holds its right (j+1) neighbour
+static inline uint64_t bp_right(const uint64_t *row, int w, int W, int N) {
+    if (w < W - 1) return (row[w] >> 1) | (row[w+1] << 63);
+    int nlast = N - 64 * (W - 1);
+    return (row[w] >> 1) | ((row[0] & 1) << (nlast - 1));
+}
+
+// Word w of the row shifted so that each bit holds its left (j-1) neighbour
+static inline uint64_t bp_left(const uint64_t *row, int w, int W, int N) {
+    int nlast = N - 64 * (W - 1);
+    uint64_t carry = w > 0 ? row[w-1] >> 63 : (row[W-1] >> (nlast - 1)) & 1;
+    uint64_t word = (row[w] << 1) | carry;
+    return w == W - 1 ? word & bp_lastmask(N) : word;
+}
+
+static inline int bp_popcount(uint64_t x) { return __builtin_popcountll(x); }
+
+// Union-find over site indices: parent[k] == k for roots, size valid at
+// roots. Path halving in find, union by size.
+static inline int uf_find(int *parent, int k) {
+    while (parent[k] != k) {
+        parent[k] = parent[parent[k]];
+        k = parent[k];
+    }
+    return k;
+}
+
+static inline int uf_union(int *parent, int *size, int a, int b) {
+    a = uf_find(parent, a);
+    b = uf_find(parent, b);
+    if (a == b) return a;
+    if (size[a] < size[b]) { int t = a; a = b; b = t; }
+    parent[b] = a;
+    size[a] += size[b];
+    return a;
+}
+
+// Union-find that also tracks the unwrapped displacement (dx, dy) of each
+// site from its root, so that a bond closing a loop around the periodic
+// lattice can be detected. Full path compression.
+static inline int uf_find_disp(int *parent, int *dx, int *dy, int k, int *ox, int *oy) {
+    int root = k, x = 0, y = 0;
+    while (parent[root] != root) {
+        x += dx[root];
+        y += dy[root];
+        root = parent[root];
+    }
+    *ox = x;
+    *oy = y;
+    while (parent[k] != root) {
+        int next = parent[k], nx = x - dx[k], ny = y - dy[k];
+        parent[k] = root;
+        dx[k] = x;
+        dy[k] = y;
+        k = next;
+        x = nx;
+        y = ny;
+    }
+    return root;
+}
+
+// Join the clusters of a and b, where b sits at (ddx, ddy) from a. If they
+// were already joined the bond closes a loop: a non-zero mismatch in the
+// displacements ors 1 (x) or 2 (y) into *wraps, and *absorbed is -1.
+// Otherwise *absorbed is the root attached below the new one (its size is
+// still that of its old cluster). Returns the root.
+static inline int uf_union_disp(int *parent, int *size, int *dx, int *dy,
+                                int a, int b, int ddx, int ddy, int *wraps, int *absorbed) {
+    int ax, ay, bx, by;
+    int ra = uf_find_disp(parent, dx, dy, a, &ax, &ay);
+    int rb = uf_find_disp(parent, dx, dy, b, &bx, &by);
+    // displacement of rb from ra
+    int rx = ax + ddx - bx, ry = ay + ddy - by;
+    if (ra == rb) {
+        *wraps |= (rx != 0) | (ry != 0) << 1;
+        *absorbed = -1;
+        return ra;
+    }
+    if (size[ra] < size[rb]) {
+        int t = ra; ra = rb; rb = t;
+        rx = -rx;
+        ry = -ry;
+    }
+    parent[rb] = ra;
+    dx[rb] = rx;
+    dy[rb] = ry;
+    size[ra] += size[rb];
+    *absorbed = rb;
+    return ra;
+}
+
+long long ising_energy(const int *lattice, int N);
+long long ising_magnetisation(const int *lattice, int N);
+void state_init(ising_state *st);
+void run_observers(observer *obs, int nobs, const ising_state *st);
+void metropolis_run(ising_state *st, long long nsweeps, observer *obs, int nobs);
+void wang_landau_run(ising_state *st, long long nsweeps, double *lng, long long *hist,
+                     int lo, int hi, double lnf);
+void population_run(ising_state *pop, int first, int last, double beta, long long nsweeps);
+double population_resample(ising_state *pop, int R, double dbeta, double u,
+                           double *work, int *count, int *family);
+void umbrella_run(ising_state *st, long long nsweeps, double h, int lo, int hi,
+                  double spring, double M0, observer *obs, int nobs);
+void muca_run(ising_state *st, long long nsweeps, const double *lng, observer *obs, int nobs);
+
+void measure_energy_histogram(energy_histogram *h, const ising_state *st);
+void measure_magnetisation_histogram(magnetisation_histogram *h, const ising_state *st);
+void measure_series(time_series *ts, const ising_state *st);
+void measure_moments(moments *mo, const ising_state *st);
+void measure_structure_factor(structure_factor *sf, const ising_state *st);
+void measure_coarsening(coarsening *c, const ising_state *st);
+void measure_mcrg(mcrg *g, const ising_state *st);
+void measure_movie(movie *m, const ising_state *st);
+void measure_snapshot(snapshot *s, const ising_state *st);
+void measure_aging(aging *a, const ising_state *st);
+int snapshot_read(const snapshot_header *h, uint8_t *frame, int64_t *meta);
+
+void block_moments(const long long *E, const long long *M, long long count, long long size,
+                   int N, double e0, double *out);
+void bootstrap_means(const double *sums, const double *weights, int nblocks, int ncols,
+                     uint64_t seed, long long first, long long last, double *out);
+
+void structure_factor_add(const fft_plan *p, const int *lattice, double *power);
+void correlation_function(const fft_plan *p, const double *power, double *corr);
+void radial_average(const fft_plan *p, const double *half, double *out);
+
+void block_spin(const int *lattice, int N, int b, uint64_t *rng, int *out);
+void block_spin_packed(const uint64_t *packed, int N, int b, uint64_t *rng, uint64_t *out);
+
+void render_lattice(const int *lattice, int N, int b, int ncolors, uint8_t *pixels);
+long png_encode(const int *lattice, int N, int b, const uint8_t *palette, int ncolors,
+                uint8_t *raw, int *work, uint8_t *out);
+int movie_open(movie *m, const char *path);
+int movie_close(movie *m);
+
+int largest_cluster(const int *lattice, int N, int spin, int *work);
+int ffs_trial(ising_state *st, double h, int spin, int lambdaA, int next, long long maxsweeps, int *work);
+long long ffs_flux(ising_state *st, double h, int spin, int lambdaA, int lambda0, int lambdaB,
+                   long long nsweeps, const int *reset, uint64_t *store, int maxstore, int *nstored, int *work);
+
+long long pimc_run(int *lattice, int N, int P, double Ks, double Kt, int method, int clusters,
+                   uint64_t *rng, long long nsweeps, int *work, double *acc);
+
+void kcm_init(kcm_state *st);
+void kcm_run(kcm_state *st, const double *times, int ntimes, double *persistence, double *density);
+
+void newman_ziff(int N, int bonds, uint64_t *rng, int samples, int *work,
+                 double *largest, double *largest2, double *chi, double *wrap_any, double *wrap_both);
+
+void label_rows(const int *lattice, int N, int spin, int i0, int i1, int *labels,
+                uint64_t *packed, uint64_t *rows, int *work);
+int label_join(int N, int spin, const int *strips, int nstrips, int *labels, const uint64_t *packed,
+               uint64_t *rows, int *work, int *sizes, int capacity, unsigned char *wraps, int *nboundary);
+void label_write(int N, int spin, int i0, int i1, int *labels, const uint64_t *packed,
+                 uint64_t *rows, const int *work);
+void cluster_sizes(const int *labels, long n, int *sizes, int K);
+
+void pack_lattice(const int *lattice, uint64_t *packed, int N);
+void unpack_lattice(const uint64_t *packed, int *lattice, int N);
+long long packed_energy(const uint64_t *packed, int N);
+long long packed_magnetisation(const uint64_t *packed, int N);
+
+#endif
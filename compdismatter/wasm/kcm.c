@@ -0,0 +1,102 @@
+#include <math.h>
+#include "ising.h"
+
+// Kinetically constrained models on the N x N lattice with n_i in {0, 1}.
+// A facilitated site flips 0 -> 1 at rate c and 1 -> 0 at rate 1 - c.
+// FA: facilitated with at least f excited neighbours.
+// East: facilitated when the site above or to the left is excited.
+// Continuous-time, rejection-free dynamics over the sets of facilitated
+// unexcited and excited sites, updated locally after every flip.
+
+static int facilitated(const kcm_state *st, int i, int j) {
+    int N = st->N;
+    const int *n = st->lattice;
+    if (st->model == KCM_EAST) return n[((i-1+N)%N)*N + j] | n[i*N + (j-1+N)%N];
+    int excited = n[((i+1)%N)*N + j] + n[i*N + (j+1)%N] + n[((i-1+N)%N)*N + j] + n[i*N + (j-1+N)%N];
+    return excited >= st->f;
+}
+
+static void set_remove(kcm_state *st, int k) {
+    int n2 = st->N * st->N;
+    int pos = st->where[k];
+    if (pos < 0) return;
+    int cls = pos >= n2;
+    int last = cls * n2 + --st->count[cls];
+    int moved = st->members[last];
+    st->members[pos] = moved;
+    st->where[moved] = pos;
+    st->where[k] = -1;
+}
+
+static void set_insert(kcm_state *st, int k) {
+    int n2 = st->N * st->N;
+    int cls = st->lattice[k];
+    int pos = cls * n2 + st->count[cls]++;
+    st->members[pos] = k;
+    st->where[k] = pos;
+}
+
+static void refresh(kcm_state *st, int i, int j) {
+    int k = i * st->N + j;
+    set_remove(st, k);
+    if (facilitated(st, i, j)) set_insert(st, k);
+}
+
+void kcm_init(kcm_state *st) {
+    int N = st->N;
+    st->count[0] = st->count[1] = 0;
+    for (int k = 0; k < N*N; ++k) {
+        st->where[k] = -1;
+        st->persistent[k] = 1;
+    }
+    st->npersistent = (long long)N * N;
+    for (int i = 0; i < N; ++i)
+        for (int j = 0; j < N; ++j)
+            if (facilitated(st, i, j)) set_insert(st, i*N + j);
+}
+
+// Advance to each of the increasing times in turn, recording the fraction
+// of sites that have never flipped and the density of excitations. Stops
+// early (time = INFINITY) if no site is facilitated.
+void kcm_run(kcm_state *st, const double *times, int ntimes, double *persistence, double *density) {
+    int N = st->N;
+    double n2 = (double) N * N;
+    long long excited = 0;
+    for (int k = 0; k < N*N; ++k) excited += st->lattice[k];
+    for (int m = 0; m < ntimes; ++m) {
+        while (1) {
+            double r0 = st->c * st->count[0], r1 = (1 - st->c) * st->count[1];
+            double total = r0 + r1;
+            if (total <= 0) {
+                st->time = INFINITY;
+                break;
+            }
+            double dt = -log(1 - rng_uniform(&st->rng)) / total;
+            if (st->time + dt > times[m]) {
+                // memoryless: the next event is redrawn from times[m]
+                st->time = times[m];
+                break;
+            }
+            st->time += dt;
+            int cls = rng_uniform(&st->rng) * total >= r0;
+            int k = st->members[cls * N * N + rng_below(&st->rng, st->count[cls])];
+            set_remove(st, k);
+            st->lattice[k] ^= 1;
+            excited += st->lattice[k] ? 1 : -1;
+            set_insert(st, k);
+            if (st->persistent[k]) {
+                st->persistent[k] = 0;
+                st->npersistent--;
+            }
+            int i = k / N, j = k % N;
+            refresh(st, (i+1)%N, j);
+            refresh(st, i, (j+1)%N);
+            if (st->model != KCM_EAST) {
+                refresh(st, (i-1+N)%N, j);
+                refresh(st, i, (j-1+N)%N);
+            }
+        }
+        persistence[m] = st->npersistent / n2;
+        density[m] = excited / n2;
+    }
+}
@@ -0,0 +1,288 @@
+#include "ising.h"
+
+// Hoshen-Kopelman labelling of the nearest-neighbour clusters of equal
+// spins on the periodic N x N lattice. spin = +1 or -1 labels only clusters
+// of that spin (other sites get -1), spin = 0 labels every domain.
+//
+// The provisional labels are the runs: maximal stretches of included sites
+// of one spin along a row, not wrapping around its end. A row holds at most
+// N runs, so numbering the runs of a strip starting at row i0 from i0 N in
+// row-major order keeps those of different strips apart, and the runs of
+// row i stay below i N + N. Runs are found on the bit-packed lattice a word
+// at a time, and the labels array doubles as their union-find forest, so no
+// scratch proportional to N^2 ints is needed. Entries always point at lower
+// runs, and a root holds its own index:
+//
+// 1. label_rows, one call per strip (on separate threads): one union per
+//    stretch of a run lying along a run of the row above, linking the
+//    larger root to the smaller. Every provisional cluster is embedded in
+//    the plane.
+// 2. label_join joins the strips, then the periodic bonds join the
+//    provisional clusters touching the edges, at most 4 N of them, in a
+//    small displacement-tracking union-find; a bond joining a cluster to
+//    itself at a non-zero displacement means that it wraps around the
+//    torus. Their roots are tagged -2 - c with their cluster number c. A
+//    forward pass over the runs replaces every entry by its cluster number
+//    (entries point at lower runs, which already hold theirs), and the
+//    sizes are added up a run at a time.
+// 3. label_write, one call per strip: a backward pass over the sites, rows
+//    from the bottom and each row from the right, writes the labels. Site j
+//    of row i reads the entry of its run, between i0 N and i N + j since
+//    its row has at most j runs before it, so no entry is read after being
+//    overwritten, by this strip or another.
+//
+// packed holds N bp_words(N) words, rows 2 bp_words(N) words per call and
+// work 30 N ints; wraps holds 4 N bytes. Clusters touching the edges come
+// first, numbered 0 .. *nboundary - 1 with their wrap flags (1 in x, 2 in
+// y) in wraps; the others cannot wrap. sizes receives the sizes of clusters
+// below capacity (see cluster_sizes for the rest).
+
+static inline int planar_find(int *forest, int p) {
+    while (forest[p] != p) {
+        forest[p] = forest[forest[p]];
+        p = forest[p];
+    }
+    return p;
+}
+
+// Root of p after pass 1: an untagged root (forest[r] == r) or a tagged one
+static inline int tagged_find(const int *forest, int p) {
+    while (forest[p] >= 0 && forest[p] != p) p = forest[p];
+    return p;
+}
+
+// Sites of a word of a bit-packed row that take part in the labelling
+static inline uint64_t included(uint64_t word, int spin) {
+    return spin > 0 ? word : spin < 0 ? ~word : ~0ULL;
+}
+
+// First sites of the runs of included sites along a bit-packed row: the
+// included sites whose left neighbour has the other spin, and site 0;
+// returns the number of runs
+static int row_starts(const uint64_t *row, int N, int spin, uint64_t *starts) {
+    int W = bp_words(N), runs = 0;
+    uint64_t carry = ~row[0] & 1;
+    for (int w = 0; w < W; ++w) {
+        uint64_t word = row[w];
+        starts[w] = included(word, spin) & (word ^ ((word << 1) | carry));
+        carry = word >> 63;
+    }
+    starts[W-1] &= bp_lastmask(N);
+    for (int w = 0; w < W; ++w) runs += bp_popcount(starts[w]);
+    return runs;
+}
+
+// Last sites of the runs, likewise: their right neighbour has the other
+// spin, or they end the row
+static void row_ends(const uint64_t *row, int N, int spin, uint64_t *ends) {
+    int W = bp_words(N);
+    for (int w = 0; w < W; ++w) {
+        uint64_t word = row[w], next = w + 1 < W ? row[w+1] : 0;
+        ends[w] = included(word, spin) & (word ^ ((word >> 1) | (next << 63)));
+    }
+    ends[W-1] &= bp_lastmask(N);
+    ends[W-1] |= 1ULL << ((N - 1) & 63) & included(row[W-1], spin);
+}
+
+// Run of site j of a row, given the starts of the row and its first run
+static int run_of(const uint64_t *starts, int first, int j) {
+    int run = first - 1;
+    for (int w = 0; w < j >> 6; ++w) run += bp_popcount(starts[w]);
+    return run + bp_popcount(starts[j >> 6] & ((2ULL << (j & 63)) - 1));
+}
+
+static inline int site_bit(const uint64_t *packed, int W, int i, int j) {
+    return (int)(packed[(long)i * W + (j >> 6)] >> (j & 63)) & 1;
+}
+
+// Join the runs of a row to those of the row above, one union per stretch
+// of equal spins along both, marked by its first site in joins
+static void join_rows(int *forest, const uint64_t *bits, const uint64_t *up, const uint64_t *starts,
+                      const uint64_t *above, int first, int first_above, int N, int spin) {
+    int W = bp_words(N), rank = 0, rank_above = 0;
+    uint64_t carry = 0;
+    for (int w = 0; w < W; ++w) {
+        uint64_t s = starts[w], same = included(bits[w], spin) & ~(bits[w] ^ up[w]);
+        if (w == W - 1) same &= bp_lastmask(N);
+        uint64_t joins = same & (s | ~((same << 1) | carry));
+        carry = same >> 63;
+        for (; joins; joins &= joins - 1) {
+            uint64_t left = (2ULL << __builtin_ctzll(joins)) - 1;
+            int a = planar_find(forest, first_above + rank_above + bp_popcount(above[w] & left) - 1);
+            int b = planar_find(forest, first + rank + bp_popcount(s & left) - 1);
+            int lo = a < b ? a : b;
+            forest[a + b - lo] = lo;
+        }
+        rank += bp_popcount(s);
+        rank_above += bp_popcount(above[w]);
+    }
+}
+
+// Add the length of every run of a row to the size of its cluster, given
+// the cluster of each run in turn; the k-th start and the k-th end bound
+// the k-th run
+static void add_run_sizes(const uint64_t *starts, const uint64_t *ends, int N, const int *cluster,
+                          int *sizes, int capacity) {
+    int W = bp_words(N), we = 0;
+    uint64_t e = ends[0];
+    for (int w = 0; w < W; ++w) {
+        for (uint64_t s = starts[w]; s; s &= s - 1) {
+            while (!e) e = ends[++we];
+            int length = 64 * we + __builtin_ctzll(e) - 64 * w - __builtin_ctzll(s) + 1, id = *cluster++;
+            e &= e - 1;
+            if (id < capacity) sizes[id] += length;
+        }
+    }
+}
+
+// Compact id of the provisional cluster of run p, tagging its root
+static int edge_cluster(int *forest, int p, int *parent, int *size, int *dx, int *dy,
+                        int *flags, int *site, int *count) {
+    int r = tagged_find(forest, p);
+    if (forest[r] < -1) return -2 - forest[r];
+    int c = (*count)++;
+    parent[c] = c;
+    size[c] = 1;
+    dx[c] = dy[c] = 0;
+    flags[c] = 0;
+    site[c] = r;
+    forest[r] = -2 - c;
+    return c;
+}
+
+static void edge_join(int *forest, int a, int b, int ddx, int ddy, int *parent, int *size, int *dx,
+                      int *dy, int *flags, int *site, int *count) {
+    int ca = edge_cluster(forest, a, parent, size, dx, dy, flags, site, count);
+    int cb = edge_cluster(forest, b, parent, size, dx, dy, flags, site, count);
+    int w = 0, absorbed;
+    int root = uf_union_disp(parent, size, dx, dy, ca, cb, ddx, ddy, &w, &absorbed);
+    flags[root] |= w | (absorbed >= 0 ? flags[absorbed] : 0);
+}
+
+// Pass 1 on rows i0 .. i1-1: packs them and joins their runs. work holds
+// the first run of each row, then the end of its runs.
+void label_rows(const int *lattice, int N, int spin, int i0, int i1, int *labels,
+                uint64_t *packed, uint64_t *rows, int *work) {
+    int W = bp_words(N), *first = work, *end = work + N, *forest = labels;
+    int runs = (int)((long)i0 * N);
+    uint64_t *starts = rows, *above = rows + W;
+    for (int i = i0; i < i1; ++i) {
+        const int *row = lattice + (long)i * N;
+        uint64_t *bits = packed + (long)i * W;
+        for (int w = 0; w < W; ++w) {
+            int j0 = 64 * w, j1 = j0 + 64 < N ? j0 + 64 : N;
+            uint64_t word = 0;
+            for (int j = j0; j < j1; ++j) word |= (uint64_t)(row[j] > 0) << (j - j0);
+            bits[w] = word;
+        }
+        uint64_t *t = above;
+        above = starts;
+        starts = t;
+        first[i] = runs;
+        runs += row_starts(bits, N, spin, starts);
+        end[i] = runs;
+        for (int p = first[i]; p < runs; ++p) forest[p] = p;
+        if (i > i0) join_rows(forest, bits, bits - W, starts, above, first[i], first[i-1], N, spin);
+    }
+}
+
+// Pass 2, once the strips starting at rows strips[0] = 0 .. strips[nstrips-1]
+// are done; returns the number of clusters
+int label_join(int N, int spin, const int *strips, int nstrips, int *labels, const uint64_t *packed,
+               uint64_t *rows, int *work, int *sizes, int capacity, unsigned char *wraps, int *nboundary) {
+    int W = bp_words(N), *first = work, *end = work + N, *forest = labels;
+    uint64_t *starts = rows, *above = rows + W;
+    for (int k = 1; k < nstrips; ++k) {
+        const uint64_t *bits = packed + (long)strips[k] * W;
+        row_starts(bits, N, spin, starts);
+        row_starts(bits - W, N, spin, above);
+        join_rows(forest, bits, bits - W, starts, above, first[strips[k]], first[strips[k]-1], N, spin);
+    }
+
+    int E = 4 * N;
+    int *parent = work + 2 * N, *size = parent + E, *dx = parent + 2 * E, *dy = parent + 3 * E;
+    int *flags = parent + 4 * E, *site = parent + 5 * E, *final = parent + 6 * E;
+    int count = 0, in = spin > 0;
+    for (int i = 0; i < N; ++i) {
+        int a = site_bit(packed, W, i, N - 1);
+        if ((!spin || a == in) && a == site_bit(packed, W, i, 0))
+            edge_join(forest, end[i] - 1, first[i], 1, 0, parent, size, dx, dy, flags, site, &count);
+    }
+    row_starts(packed + (long)(N - 1) * W, N, spin, starts);
+    row_starts(packed, N, spin, above);
+    for (int j = 0; j < N; ++j) {
+        int a = site_bit(packed, W, N - 1, j);
+        if ((!spin || a == in) && a == site_bit(packed, W, 0, j))
+            edge_join(forest, run_of(starts, first[N-1], j), run_of(above, first[0], j), 0, 1,
+                      parent, size, dx, dy, flags, site, &count);
+    }
+
+    // number the periodic clusters first, then retag their provisional roots
+    int nclusters = 0, ox, oy;
+    for (int c = 0; c < count; ++c) final[c] = -1;
+    for (int c = 0; c < count; ++c) {
+        int r = uf_find_disp(parent, dx, dy, c, &ox, &oy);
+        if (final[r] < 0) {
+            final[r] = nclusters;
+            wraps[nclusters] = flags[r];
+            nclusters++;
+        }
+        forest[site[c]] = -2 - final[r];
+    }
+    *nboundary = nclusters;
+
+    // tagged roots map to their cluster, the other roots to a new one and
+    // the remaining runs to the cluster of the (lower) run they point at
+    for (int i = 0; i < N; ++i) {
+        for (int p = first[i]; p < end[i]; ++p) {
+            int v = forest[p];
+            forest[p] = v < 0 ? -2 - v : v == p ? nclusters++ : forest[v];
+        }
+    }
+
+    for (int id = 0; id < capacity && id < nclusters; ++id) sizes[id] = 0;
+    for (int i = 0; i < N; ++i) {
+        const uint64_t *bits = packed + (long)i * W;
+        row_starts(bits, N, spin, starts);
+        row_ends(bits, N, spin, above);
+        add_run_sizes(starts, above, N, forest + first[i], sizes, capacity);
+    }
+    return nclusters;
+}
+
+// Pass 3 on rows i0 .. i1-1
+void label_write(int N, int spin, int i0, int i1, int *labels, const uint64_t *packed,
+                 uint64_t *rows, const int *work) {
+    int W = bp_words(N);
+    const int *first = work, *end = work + N, *forest = labels;
+    for (int i = i1 - 1; i >= i0; --i) {
+        const uint64_t *bits = packed + (long)i * W;
+        int *lab = labels + (long)i * N;
+        if (first[i] == end[i]) {
+            for (int j = 0; j < N; ++j) lab[j] = -1;
+            continue;
+        }
+        row_starts(bits, N, spin, rows);
+        // run of the current site, moving to the run on the left past every
+        // start. Excluded sites get -1 by masking rather than a branch (a
+        // random lattice mispredicts half of them), so every site reads an
+        // entry: left of the first run that of the first run
+        int p = end[i] - 1, lo = first[i];
+        for (int w = W - 1; w >= 0; --w) {
+            uint64_t take = included(bits[w], spin), s = rows[w];
+            for (int b = (64 * w + 64 < N ? 64 : N - 64 * w) - 1; b >= 0; --b) {
+                int excluded = ((int)(take >> b) & 1) - 1;
+                lab[64 * w + b] = forest[p < lo ? lo : p] | excluded;
+                p -= (int)(s >> b) & 1;
+            }
+        }
+    }
+}
+
+// Sizes of clusters 0 .. K-1 from final labels (-1 for excluded sites)
+void cluster_sizes(const int *labels, long n, int *sizes, int K) {
+    for (int id = 0; id < K; ++id) sizes[id] = 0;
+    for (long k = 0; k < n; ++k) {
+        if (labels[k] >= 0) sizes[labels[k]]++;
+    }
+}
@@ -0,0 +1,36 @@
+#include <math.h>
+#include "ising.h"
+
+// All blocks full: merge neighbouring pairs into the lower half and double
+// the block size, so any run length ends with between nblocks / 2 and
+// nblocks blocks
+static void moments_rebin(moments *mo) {
+    int half = mo->nblocks / 2;
+    for (int i = 0; i < half; ++i) {
+        for (int q = 0; q < MOMENTS; ++q) {
+            double s = mo->sum[2*i*MOMENTS + q], c = mo->comp[2*i*MOMENTS + q];
+            neumaier_add(&s, &c, mo->sum[(2*i + 1)*MOMENTS + q]);
+            c += mo->comp[(2*i + 1)*MOMENTS + q];
+            mo->sum[i*MOMENTS + q] = s;
+            mo->comp[i*MOMENTS + q] = c;
+        }
+    }
+    for (int k = half * MOMENTS; k < mo->nblocks * MOMENTS; ++k) {
+        mo->sum[k] = 0;
+        mo->comp[k] = 0;
+    }
+    mo->block_size *= 2;
+}
+
+void measure_moments(moments *mo, const ising_state *st) {
+    double n = (double)st->N * st->N;
+    if (mo->count == 0) mo->e0 = st->E / n;
+    if (mo->count == (long long)mo->nblocks * mo->block_size) moments_rebin(mo);
+
+    double m = fabs((double)st->M) / n, m2 = m * m, e = st->E / n - mo->e0;
+    double x[MOMENTS] = {m, m2, m2 * m2, e, e * e};
+    long long k = mo->count / mo->block_size;
+    for (int q = 0; q < MOMENTS; ++q)
+        neumaier_add(&mo->sum[k*MOMENTS + q], &mo->comp[k*MOMENTS + q], x[q]);
+    mo->count++;
+}
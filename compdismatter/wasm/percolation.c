@@ -0,0 +1,81 @@
+#include "ising.h"
+
+// Newman-Ziff percolation on the periodic N x N square lattice. Sites (or
+// bonds) are occupied one at a time in random order, merging clusters with
+// union-find; every observable is recorded after each addition, so a
+// single pass covers all occupation numbers n = 0 .. M, with M = N^2 sites
+// or 2 N^2 bonds.
+
+typedef struct {
+    int *parent, *size, *dx, *dy;
+    long long sum2;     // sum of squared cluster sizes
+    int largest;
+    int wraps;          // 1: some cluster wraps in x, 2: in y, 3: both
+} nz_clusters;
+
+// Join the clusters of sites a and b, where b sits at (ddx, ddy) from a
+static void nz_bond(nz_clusters *c, int a, int b, int ddx, int ddy) {
+    int absorbed;
+    int root = uf_union_disp(c->parent, c->size, c->dx, c->dy, a, b, ddx, ddy, &c->wraps, &absorbed);
+    if (absorbed >= 0) {
+        // (sa + sb)^2 - sa^2 - sb^2
+        long long sb = c->size[absorbed], sa = c->size[root] - sb;
+        c->sum2 += 2 * sa * sb;
+        if (c->size[root] > c->largest) c->largest = c->size[root];
+    }
+}
+
+// Accumulate over samples, for each n, the largest-cluster fraction and its
+// square, chi = (sum s^2 - largest^2) / N^2, and the number of samples in
+// which some cluster wraps in either or in both directions. work holds 6 N^2 ints.
+void newman_ziff(int N, int bonds, uint64_t *rng, int samples, int *work,
+                 double *largest, double *largest2, double *chi, double *wrap_any, double *wrap_both) {
+    int n2 = N * N;
+    int M = bonds ? 2 * n2 : n2;
+    nz_clusters c = {work, work + n2, work + 2 * n2, work + 3 * n2, 0, 0, 0};
+    int *order = work + 4 * n2;
+    for (int s = 0; s < samples; ++s) {
+        for (int k = 0; k < M; ++k) order[k] = k;
+        for (int k = M - 1; k > 0; --k) {
+            int r = rng_below(rng, k + 1), t = order[k];
+            order[k] = order[r];
+            order[r] = t;
+        }
+        for (int k = 0; k < n2; ++k) {
+            // sites start present for bond percolation, empty for site percolation
+            c.parent[k] = bonds ? k : -1;
+            c.size[k] = 1;
+            c.dx[k] = c.dy[k] = 0;
+        }
+        c.sum2 = bonds ? n2 : 0;
+        c.largest = bonds ? 1 : 0;
+        c.wraps = 0;
+
+        for (int n = 0; n <= M; ++n) {
+            if (n > 0) {
+                int e = order[n-1];
+                if (bonds) {
+                    int k = e >> 1, i = k / N, j = k % N;
+                    if (e & 1) nz_bond(&c, k, ((i+1)%N)*N + j, 0, 1);
+                    else nz_bond(&c, k, i*N + (j+1)%N, 1, 0);
+                } else {
+                    int k = e, i = k / N, j = k % N;
+                    c.parent[k] = k;
+                    c.sum2 += 1;
+                    if (c.largest < 1) c.largest = 1;
+                    int nb[4] = {((i+1)%N)*N + j, ((i-1+N)%N)*N + j, i*N + (j+1)%N, i*N + (j-1+N)%N};
+                    int ddx[4] = {0, 0, 1, -1}, ddy[4] = {1, -1, 0, 0};
+                    for (int d = 0; d < 4; ++d) {
+                        if (c.parent[nb[d]] >= 0) nz_bond(&c, k, nb[d], ddx[d], ddy[d]);
+                    }
+                }
+            }
+            double frac = (double) c.largest / n2;
+            largest[n] += frac;
+            largest2[n] += frac * frac;
+            chi[n] += (double)(c.sum2 - (long long)c.largest * c.largest) / n2;
+            wrap_any[n] += c.wraps != 0;
+            wrap_both[n] += c.wraps == 3;
+        }
+    }
+}
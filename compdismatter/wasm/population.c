@@ -0,0 +1,55 @@
+#include <math.h>
+#include <string.h>
+#include "ising.h"
+
+// Metropolis sweeps at beta for members [first, last) of a population
+void population_run(ising_state *pop, int first, int last, double beta, long long nsweeps) {
+    for (int k = first; k < last; ++k) {
+        pop[k].beta = beta;
+        metropolis_run(&pop[k], nsweeps, NULL, 0);
+    }
+}
+
+// Resample the population to the next temperature with weights
+// exp(-dbeta E) by systematic resampling from the prefix sum of the weights
+// (u uniform in [0, 1)). Members keep their own lattice slot; only the
+// slots of members that die receive copies of members that multiply.
+// work is scratch space for R doubles, count receives the multiplicities.
+// Returns ln Q = ln (1/R sum_i exp(-dbeta E_i)), the free-energy increment.
+double population_resample(ising_state *pop, int R, double dbeta, double u,
+                           double *work, int *count, int *family) {
+    long long Emin = pop[0].E;
+    for (int k = 1; k < R; ++k) if (pop[k].E < Emin) Emin = pop[k].E;
+
+    double total = 0;
+    for (int k = 0; k < R; ++k) {
+        total += exp(-dbeta * (pop[k].E - Emin));
+        work[k] = total;
+    }
+
+    long long prev = 0;
+    for (int k = 0; k < R; ++k) {
+        long long upto = k == R - 1 ? R : (long long) ceil(R * work[k] / total - u);
+        if (upto > R) upto = R;
+        if (upto < prev) upto = prev;
+        count[k] = (int)(upto - prev);
+        prev = upto;
+    }
+
+    int N = pop[0].N;
+    size_t bytes = (size_t) N * N * sizeof(int);
+    int dst = 0;
+    for (int src = 0; src < R; ++src) {
+        for (int c = 1; c < count[src]; ++c) {
+            while (count[dst] != 0) dst++;
+            memcpy(pop[dst].lattice, pop[src].lattice, bytes);
+            pop[dst].E = pop[src].E;
+            pop[dst].M = pop[src].M;
+            family[dst] = family[src];
+            count[dst] = -1;    // slot now taken by a copy
+        }
+    }
+    for (int k = 0; k < R; ++k) if (count[k] < 0) count[k] = 0;
+
+    return log(total / R) - dbeta * Emin;
+}
@@ -0,0 +1,35 @@
+#include "ising.h"
+
+// Q2R reversible cellular automaton: a spin flips when exactly two of its
+// four neighbours are up, i.e. when flipping costs no energy. The two
+// checkerboard sublattices are updated in turn, 64 sites per instruction.
+static inline uint64_t exactly_two(uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
+    uint64_t s1 = a ^ b, c1 = a & b;
+    uint64_t s2 = c ^ d, c2 = c & d;
+    return (s1 & s2) | ((c1 ^ c2) & ~(s1 | s2));
+}
+
+// Returns -1 for odd N, where the checkerboard is inconsistent with periodic
+// boundaries. If energies is not NULL it receives the energy after each sweep.
+int q2r(uint64_t *packed, int N, int nsweeps, long long *energies) {
+    if (N < 2 || N % 2) return -1;
+    int W = bp_words(N);
+    const uint64_t even = 0x5555555555555555ULL;
+    for (int t = 0; t < nsweeps; ++t) {
+        for (int p = 0; p < 2; ++p) {
+            for (int i = 0; i < N; ++i) {
+                uint64_t *row = packed + (long)i * W;
+                const uint64_t *up = packed + (long)((i-1+N) % N) * W;
+                const uint64_t *down = packed + (long)((i+1) % N) * W;
+                uint64_t mask = (p + i) & 1 ? ~even : even;
+                for (int w = 0; w < W; ++w) {
+                    uint64_t flip = exactly_two(bp_left(row, w, W, N), bp_right(row, w, W, N), up[w], down[w]);
+                    row[w] ^= flip & mask;
+                }
+                row[W-1] &= bp_lastmask(N);
+            }
+        }
+        if (energies) energies[t] = packed_energy(packed, N);
+    }
+    return 0;
+}
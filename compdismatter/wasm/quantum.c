@@ -0,0 +1,115 @@
+#include <math.h>
+#include "ising.h"
+
+// Path-integral Monte Carlo for the transverse-field Ising model: P Trotter
+// slices of N x N spins, each in the layout of mcmove, stored one after the
+// other. Spatial bonds have coupling Ks = beta J / P, imaginary-time bonds
+// Kt = -ln tanh(beta Gamma / P) / 2, which is large at low temperature.
+
+static inline int pimc_neighbour(int site, int d, int N, int P) {
+    int n = N * N;
+    int t = site / n, i = (site % n) / N, j = site % N;
+    switch (d) {
+    case 0: return t*n + ((i+1)%N)*N + j;
+    case 1: return t*n + ((i-1+N)%N)*N + j;
+    case 2: return t*n + i*N + (j+1)%N;
+    case 3: return t*n + i*N + (j-1+N)%N;
+    case 4: return ((t+1)%P)*n + i*N + j;
+    default: return ((t-1+P)%P)*n + i*N + j;
+    }
+}
+
+// Single Wolff cluster grown with probabilities 1 - exp(-2K) along each
+// bond; stack holds N^2 P ints. Returns the cluster size.
+static long long pimc_wolff_cluster(int *lattice, int N, int P, const double *padd, uint64_t *rng, int *stack) {
+    long long n3 = (long long)N * N * P;
+    int seed = (int)(rng_next(rng) % n3);
+    int s = lattice[seed];
+    long long top = 0, size = 1;
+    lattice[seed] = -s;
+    stack[top++] = seed;
+    while (top) {
+        int site = stack[--top];
+        for (int d = 0; d < 6; ++d) {
+            int nb = pimc_neighbour(site, d, N, P);
+            if (lattice[nb] == s && rng_uniform(rng) < padd[d >> 1 == 2]) {
+                lattice[nb] = -s;
+                stack[top++] = nb;
+                size++;
+            }
+        }
+    }
+    return size;
+}
+
+// Swendsen-Wang: activate bonds between equal spins, label the clusters
+// with union-find and flip each with probability 1/2. work holds 3 N^2 P ints.
+static void pimc_sw_sweep(int *lattice, int N, int P, const double *padd, uint64_t *rng, int *work) {
+    int n3 = N * N * P;
+    int *parent = work, *size = work + n3, *flip = work + 2 * n3;
+    for (int k = 0; k < n3; ++k) {
+        parent[k] = k;
+        size[k] = 1;
+    }
+    // forward bonds only: down, right, next slice
+    static const int dirs[3] = {0, 2, 4};
+    for (int k = 0; k < n3; ++k) {
+        for (int d = 0; d < 3; ++d) {
+            int nb = pimc_neighbour(k, dirs[d], N, P);
+            if (lattice[nb] == lattice[k] && rng_uniform(rng) < padd[d == 2]) uf_union(parent, size, k, nb);
+        }
+    }
+    for (int k = 0; k < n3; ++k) if (parent[k] == k) flip[k] = rng_next(rng) >> 63;
+    for (int k = 0; k < n3; ++k) if (flip[uf_find(parent, k)]) lattice[k] = -lattice[k];
+}
+
+// Sums over all slices of spatial (Ss) and imaginary-time (St) bond
+// products, and the slice-averaged magnetisation
+static void pimc_measure(const int *lattice, int N, int P, double *Ss, double *St, double *M) {
+    int n = N * N;
+    long long ss = 0, st = 0, m = 0;
+    for (int t = 0; t < P; ++t) {
+        const int *slice = lattice + (long)t * n;
+        const int *next = lattice + (long)((t+1) % P) * n;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                int s = slice[i*N + j];
+                ss += s * (slice[((i+1)%N)*N + j] + slice[i*N + (j+1)%N]);
+                st += s * next[i*N + j];
+                m += s;
+            }
+        }
+    }
+    *Ss = (double) ss;
+    *St = (double) st;
+    *M = (double) m / P;
+}
+
+// nsweeps updates (one SW sweep, or `clusters` Wolff clusters) accumulating
+// after each into acc, when given: [samples, Ss, St, |M|, M^2, M^4].
+// The number of Wolff clusters per sweep is fixed rather than grown until
+// some number of spins has flipped: such a state-dependent stopping rule
+// would bias the measurements. Returns the total Wolff cluster size.
+long long pimc_run(int *lattice, int N, int P, double Ks, double Kt, int method, int clusters,
+                   uint64_t *rng, long long nsweeps, int *work, double *acc) {
+    double padd[2] = {1 - exp(-2 * Ks), 1 - exp(-2 * Kt)};
+    long long flipped = 0;
+    for (long long t = 0; t < nsweeps; ++t) {
+        if (method == 0) {
+            for (int c = 0; c < clusters; ++c) flipped += pimc_wolff_cluster(lattice, N, P, padd, rng, work);
+        } else {
+            pimc_sw_sweep(lattice, N, P, padd, rng, work);
+        }
+        if (acc) {
+            double Ss, St, M;
+            pimc_measure(lattice, N, P, &Ss, &St, &M);
+            acc[0] += 1;
+            acc[1] += Ss;
+            acc[2] += St;
+            acc[3] += fabs(M);
+            acc[4] += M * M;
+            acc[5] += M * M * M * M;
+        }
+    }
+    return flipped;
+}
@@ -0,0 +1,284 @@
+#include <string.h>
+#include "ising.h"
+
+// Rendering of lattices to palette images and their encoding as PNG and
+// animated PNG (APNG), with a small built-in deflate: LZ77 against the
+// previous byte, the previous row and a one-entry hash of earlier
+// positions, coded with the fixed Huffman tables. Domain images compress
+// well this way without needing zlib.
+
+// Palette index of every b x b block: the block magnetisation mapped
+// linearly onto 0 .. ncolors-1. With rows set, every row is preceded by
+// a zero byte (the PNG "no filter" tag).
+static void render(const int *lattice, int N, int b, int ncolors, uint8_t *dst, int rows) {
+    int n = N / b, b2 = b * b;
+    for (int I = 0; I < n; ++I) {
+        if (rows) *dst++ = 0;
+        for (int J = 0; J < n; ++J) {
+            const int *block = lattice + (long)I*b*N + (long)J*b;
+            int sum = 0;
+            for (int i = 0; i < b; ++i) {
+                for (int j = 0; j < b; ++j) sum += block[(long)i*N + j];
+            }
+            // 2 b^2 (ncolors - 1) exceeds int for b beyond about 2048
+            *dst++ = (uint8_t)(((long long)(sum + b2) * (ncolors - 1) + b2) / (2LL * b2));
+        }
+    }
+}
+
+void render_lattice(const int *lattice, int N, int b, int ncolors, uint8_t *pixels) {
+    render(lattice, N, b, ncolors, pixels, 0);
+}
+
+typedef struct {
+    uint8_t *out;
+    long pos;
+    uint64_t bits;
+    int nbits;
+} bitwriter;
+
+static inline void put_bits(bitwriter *w, uint32_t v, int n) {
+    w->bits |= (uint64_t)v << w->nbits;
+    w->nbits += n;
+    while (w->nbits >= 8) {
+        w->out[w->pos++] = (uint8_t)w->bits;
+        w->bits >>= 8;
+        w->nbits -= 8;
+    }
+}
+
+// Huffman codes are sent most significant bit first
+static inline void put_code(bitwriter *w, uint32_t code, int n) {
+    uint32_t r = 0;
+    for (int k = 0; k < n; ++k) r |= ((code >> k) & 1) << (n - 1 - k);
+    put_bits(w, r, n);
+}
+
+static void put_symbol(bitwriter *w, int v) {
+    if (v < 144) put_code(w, 0x30 + v, 8);
+    else if (v < 256) put_code(w, 0x190 + v - 144, 9);
+    else if (v < 280) put_code(w, v - 256, 7);
+    else put_code(w, 0xC0 + v - 280, 8);
+}
+
+static const int len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                  8193, 12289, 16385, 24577};
+static const int dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void put_match(bitwriter *w, int length, int distance) {
+    int i = 28;
+    while (len_base[i] > length) --i;
+    put_symbol(w, 257 + i);
+    put_bits(w, length - len_base[i], len_extra[i]);
+    i = 29;
+    while (dist_base[i] > distance) --i;
+    put_code(w, i, 5);
+    put_bits(w, distance - dist_base[i], dist_extra[i]);
+}
+
+enum { HASH_BITS = 15, WINDOW = 32768, MAX_MATCH = 258 };
+
+static inline uint32_t hash3(const uint8_t *p) {
+    return ((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u >> (32 - HASH_BITS);
+}
+
+// Raw deflate stream of in[0 .. len) as one fixed-Huffman block. stride is
+// the row length, tried as a match distance at every position. head holds
+// 1 << HASH_BITS ints; out needs len * 9 / 8 + 16 bytes.
+static long deflate_fixed(const uint8_t *in, long len, long stride, uint8_t *out, int *head) {
+    bitwriter w = {out, 0, 0, 0};
+    for (int h = 0; h < 1 << HASH_BITS; ++h) head[h] = -1;
+    put_bits(&w, 1, 1);     // final block
+    put_bits(&w, 1, 2);     // fixed Huffman codes
+    long p = 0;
+    while (p < len) {
+        int best = 0;
+        long bestd = 0;
+        if (p + 3 <= len) {
+            uint32_t h = hash3(in + p);
+            long cand[3] = {head[h], p - 1, p - stride};
+            long limit = len - p < MAX_MATCH ? len - p : MAX_MATCH;
+            for (int c = 0; c < 3; ++c) {
+                long q = cand[c];
+                if (q < 0 || q >= p || p - q > WINDOW) continue;
+                int m = 0;
+                while (m < limit && in[q + m] == in[p + m]) ++m;
+                if (m > best) {
+                    best = m;
+                    bestd = p - q;
+                }
+            }
+            head[h] = (int)p;
+        }
+        if (best >= 3) {
+            put_match(&w, best, (int)bestd);
+            for (long q = p + 1; q < p + best && q + 3 <= len; ++q) head[hash3(in + q)] = (int)q;
+            p += best;
+        } else {
+            put_symbol(&w, in[p++]);
+        }
+    }
+    put_symbol(&w, 256);
+    if (w.nbits) w.out[w.pos++] = (uint8_t)w.bits;
+    return w.pos;
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t adler32(const uint8_t *data, long len) {
+    uint32_t a = 1, b = 0;
+    while (len > 0) {
+        long n = len < 5552 ? len : 5552;
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+static uint32_t crc32(const uint8_t *data, long len) {
+    static const uint32_t nibble[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    uint32_t crc = 0xFFFFFFFF;
+    for (long k = 0; k < len; ++k) {
+        crc ^= data[k];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+    }
+    return ~crc;
+}
+
+// zlib stream of the scanlines (n rows of n + 1 bytes) at out
+static long zlib_stream(const uint8_t *raw, int n, uint8_t *out, int *work) {
+    long len = (long)n * (n + 1);
+    out[0] = 0x78;
+    out[1] = 0x01;
+    long size = 2 + deflate_fixed(raw, len, n + 1, out + 2, work);
+    put32(out + size, adler32(raw, len));
+    return size + 4;
+}
+
+// Chunk of length len whose data the caller has placed at out + 8
+static long chunk(uint8_t *out, const char *type, long len) {
+    put32(out, (uint32_t)len);
+    memcpy(out + 4, type, 4);
+    put32(out + 8 + len, crc32(out + 4, len + 4));
+    return len + 12;
+}
+
+static const uint8_t png_signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+static long png_header(uint8_t *out, int n, const uint8_t *palette, int ncolors, int nframes) {
+    long pos = 8;
+    memcpy(out, png_signature, 8);
+    put32(out + pos + 8, n);
+    put32(out + pos + 12, n);
+    memcpy(out + pos + 16, (uint8_t[]){8, 3, 0, 0, 0}, 5);    // 8-bit palette indices
+    pos += chunk(out + pos, "IHDR", 13);
+    if (nframes) {
+        put32(out + pos + 8, nframes);
+        put32(out + pos + 12, 0);                              // loop forever
+        pos += chunk(out + pos, "acTL", 8);
+    }
+    memcpy(out + pos + 8, palette, 3 * ncolors);
+    pos += chunk(out + pos, "PLTE", 3 * ncolors);
+    return pos;
+}
+
+// Complete PNG of a rendered lattice. raw needs n (n + 1) bytes, work
+// 1 << 15 ints and out n (n + 1) * 9 / 8 + 3 ncolors + 128 bytes.
+// Returns the size of the file written to out.
+long png_encode(const int *lattice, int N, int b, const uint8_t *palette, int ncolors,
+                uint8_t *raw, int *work, uint8_t *out) {
+    int n = N / b;
+    render(lattice, N, b, ncolors, raw, 1);
+    long pos = png_header(out, n, palette, ncolors, 0);
+    pos += chunk(out + pos, "IDAT", zlib_stream(raw, n, out + pos + 8, work));
+    return pos + chunk(out + pos, "IEND", 0);
+}
+
+// Animated PNG written frame by frame from the sweep loop
+int movie_open(movie *m, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    long size = png_header(m->out, m->n, m->palette, m->ncolors, m->nframes);
+    m->actl = 33;           // signature and IHDR come first
+    m->file = f;
+    m->frames = 0;
+    m->sequence = 0;
+    m->error = fwrite(m->out, 1, size, f) != (size_t)size;
+    return m->error ? -1 : 0;
+}
+
+// Append the frame in raw (filter bytes included)
+static void movie_frame(movie *m) {
+    uint8_t *out = m->out;
+    uint8_t *fc = out + 8;
+    put32(fc, m->sequence++);
+    put32(fc + 4, m->n);
+    put32(fc + 8, m->n);
+    put32(fc + 12, 0);
+    put32(fc + 16, 0);
+    fc[20] = m->delay_num >> 8;
+    fc[21] = m->delay_num;
+    fc[22] = m->delay_den >> 8;
+    fc[23] = m->delay_den;
+    fc[24] = fc[25] = 0;    // no disposal, overwrite
+    long pos = chunk(out, "fcTL", 26);
+
+    if (m->frames == 0) {
+        pos += chunk(out + pos, "IDAT", zlib_stream(m->raw, m->n, out + pos + 8, m->work));
+    } else {
+        put32(out + pos + 8, m->sequence++);
+        pos += chunk(out + pos, "fdAT", 4 + zlib_stream(m->raw, m->n, out + pos + 12, m->work));
+    }
+    if (fwrite(out, 1, pos, m->file) != (size_t)pos) m->error = 1;
+    m->frames++;
+}
+
+void measure_movie(movie *m, const ising_state *st) {
+    if (!m->file || m->error || m->frames == m->nframes) return;
+    render(st->lattice, st->N, m->b, m->ncolors, m->raw, 1);
+    movie_frame(m);
+}
+
+// Fix the frame count in acTL to the frames actually written and finish
+// the file; returns the number of frames recorded, or -1 if writing the
+// file failed at any point. Without any frames a blank one (palette entry
+// 0) keeps the file a valid PNG.
+int movie_close(movie *m) {
+    if (!m->file) return -1;
+    int frames = m->frames;
+    if (!frames) {
+        memset(m->raw, 0, (size_t)m->n * (m->n + 1));
+        movie_frame(m);
+    }
+    uint8_t actl[16];
+    memcpy(actl, "acTL", 4);
+    put32(actl + 4, m->frames);
+    put32(actl + 8, 0);
+    put32(actl + 12, crc32(actl, 12));
+    long size = chunk(m->out, "IEND", 0);
+    if (fseek(m->file, m->actl + 8, SEEK_SET) || fwrite(actl + 4, 1, 12, m->file) != 12
+        || fseek(m->file, 0, SEEK_END) || fwrite(m->out, 1, size, m->file) != (size_t)size) m->error = 1;
+    if (fclose(m->file)) m->error = 1;
+    m->file = NULL;
+    m->frames = frames;
+    return m->error ? -1 : frames;
+}
@@ -0,0 +1,44 @@
+#include <math.h>
+#include "ising.h"
+
+// Resampling of long E, M series: block sums of the moments columns (as
+// accumulated by measure_moments) and bootstrap means over the blocks.
+// Both work on independent ranges so that callers can split them across
+// threads.
+
+// Sums of |m|, m^2, m^4, e - e0 and (e - e0)^2 per spin over consecutive
+// blocks of size samples (the last may be shorter) of count samples
+void block_moments(const long long *E, const long long *M, long long count, long long size,
+                   int N, double e0, double *out) {
+    double n = (double)N * N;
+    long long nblocks = (count + size - 1) / size;
+    for (long long b = 0; b < nblocks; ++b) {
+        double s[MOMENTS] = {0}, c[MOMENTS] = {0};
+        long long last = (b + 1) * size < count ? (b + 1) * size : count;
+        for (long long k = b * size; k < last; ++k) {
+            double m = fabs((double)M[k]) / n, m2 = m * m, e = E[k] / n - e0;
+            double x[MOMENTS] = {m, m2, m2 * m2, e, e * e};
+            for (int q = 0; q < MOMENTS; ++q) neumaier_add(&s[q], &c[q], x[q]);
+        }
+        for (int q = 0; q < MOMENTS; ++q) out[b*MOMENTS + q] = s[q] + c[q];
+    }
+}
+
+// Means of the columns for bootstrap replicates first .. last - 1, each
+// drawing nblocks blocks with replacement. Replicate r has its own RNG
+// stream derived from seed and r, so the result does not depend on how
+// the replicates are split.
+void bootstrap_means(const double *sums, const double *weights, int nblocks, int ncols,
+                     uint64_t seed, long long first, long long last, double *out) {
+    for (long long r = first; r < last; ++r) {
+        uint64_t rng = seed ^ ((uint64_t)r * 0xD1B54A32D192ED03ULL);
+        double *row = out + (r - first) * ncols, w = 0;
+        for (int q = 0; q < ncols; ++q) row[q] = 0;
+        for (int k = 0; k < nblocks; ++k) {
+            int b = rng_below(&rng, nblocks);
+            for (int q = 0; q < ncols; ++q) row[q] += sums[(long)b*ncols + q];
+            w += weights[b];
+        }
+        for (int q = 0; q < ncols; ++q) row[q] /= w;
+    }
+}
@@ -0,0 +1,100 @@
+#include "ising.h"
+
+// Majority-rule block spins: each b x b block of an N x N lattice becomes
+// one spin of an (N / b) x (N / b) lattice. Ties (b even) are broken at
+// random with rng, or by the top-left spin of the block when rng is NULL.
+
+static inline int majority(int sum, int first, uint64_t *rng) {
+    if (sum) return sum > 0 ? 1 : -1;
+    if (!rng) return first;
+    return rng_next(rng) >> 63 ? 1 : -1;
+}
+
+void block_spin(const int *lattice, int N, int b, uint64_t *rng, int *out) {
+    int n = N / b;
+    for (int I = 0; I < n; ++I) {
+        for (int J = 0; J < n; ++J) {
+            const int *block = lattice + (long)I*b*N + (long)J*b;
+            int sum = 0;
+            for (int i = 0; i < b; ++i) {
+                for (int j = 0; j < b; ++j) sum += block[(long)i*N + j];
+            }
+            out[(long)I*n + J] = majority(sum, block[0], rng);
+        }
+    }
+}
+
+// The same on bit-packed lattices: the up spins of a block are counted
+// with one popcount per row of the block (two where it straddles a word)
+void block_spin_packed(const uint64_t *packed, int N, int b, uint64_t *rng, uint64_t *out) {
+    int n = N / b, W = bp_words(N), Wn = bp_words(n);
+    uint64_t mask = b == 64 ? ~0ULL : (1ULL << b) - 1;
+    for (int I = 0; I < n; ++I) {
+        uint64_t *orow = out + (long)I * Wn;
+        for (int w = 0; w < Wn; ++w) orow[w] = 0;
+        for (int J = 0; J < n; ++J) {
+            int col = J * b, w = col >> 6, shift = col & 63, up = 0;
+            for (int i = 0; i < b; ++i) {
+                const uint64_t *row = packed + (long)(I*b + i) * W;
+                uint64_t bits = row[w] >> shift;
+                if (shift && shift + b > 64) bits |= row[w+1] << (64 - shift);
+                up += bp_popcount(bits & mask);
+            }
+            int first = (int)(packed[(long)I*b*W + w] >> shift) & 1;
+            if (majority(2*up - b*b, 2*first - 1, rng) > 0) orow[J >> 6] |= 1ULL << (J & 63);
+        }
+    }
+}
+
+// Even (nearest neighbour, next-nearest neighbour, plaquette) and odd
+// (magnetisation, three-spin corner) operators of a periodic lattice
+static void rg_operators(const int *s, int n, double *S) {
+    long long nn = 0, nnn = 0, plaq = 0, mag = 0, three = 0;
+    for (int i = 0; i < n; ++i) {
+        const int *row = s + (long)i*n, *down = s + (long)((i+1) % n)*n;
+        for (int j = 0; j < n; ++j) {
+            int r = (j+1) % n;
+            int a = row[j], c = row[r], d = down[j], e = down[r];
+            nn += a * (c + d);
+            nnn += a * e + c * d;
+            plaq += a * c * d * e;
+            mag += a;
+            three += a * c * d;
+        }
+    }
+    S[0] = (double)nn;
+    S[1] = (double)nnn;
+    S[2] = (double)plaq;
+    S[3] = (double)mag;
+    S[4] = (double)three;
+}
+
+// Block the lattice `levels` times and accumulate the operators of every
+// level and their correlations within a level and between neighbouring
+// levels, for the linearised RG transformation
+void measure_mcrg(mcrg *g, const ising_state *st) {
+    int K = RG_OPERATORS;
+    double S[2][RG_OPERATORS];
+    const int *level = st->lattice;
+    int *work = g->work, n = st->N;
+    rg_operators(level, n, S[0]);
+    for (int l = 0; l <= g->levels; ++l) {
+        double *cur = S[l & 1], *nxt = S[(l+1) & 1];
+        double *mean = g->mean + l*K, *same = g->same + l*K*K;
+        for (int a = 0; a < K; ++a) {
+            mean[a] += cur[a];
+            for (int c = 0; c < K; ++c) same[a*K + c] += cur[a] * cur[c];
+        }
+        if (l == g->levels) break;
+        block_spin(level, n, g->b, &g->rng, work);
+        level = work;
+        n /= g->b;
+        work += (long)n * n;
+        rg_operators(level, n, nxt);
+        double *next = g->next + l*K*K;
+        for (int a = 0; a < K; ++a) {
+            for (int c = 0; c < K; ++c) next[a*K + c] += nxt[a] * cur[c];
+        }
+    }
+    g->samples++;
+}
@@ -0,0 +1,47 @@
+#include <time.h>
+#include "ising.h"
+
+// Publication of live snapshots to a viewer, at most one per interval of
+// wall-clock time, without ever waiting for the reader
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+void measure_snapshot(snapshot *s, const ising_state *st) {
+    double t = now();
+    if (t - s->last < s->interval) return;
+    s->last = t;
+    snapshot_header *h = s->shared;
+    uint64_t next = h->sequence + 1;
+    int back = next & 1;
+    long size = (long)h->n * h->n;
+    render_lattice(st->lattice, st->N, h->b, h->ncolors, (uint8_t *)(h + 1) + back * size);
+    h->sweep[back] = st->sweep;
+    h->E[back] = st->E;
+    h->M[back] = st->M;
+    __atomic_store_n(&h->sequence, next, __ATOMIC_RELEASE);
+}
+
+// Reader side: copy the frame published last with its sweep, E and M into
+// meta[1..3] and its sequence into meta[0]. Returns 1 when the copy is
+// consistent, 0 when nothing has been published or the writer published
+// again meanwhile (and may have started on the buffer copied); callers
+// retry. While sequence has not moved, the writer only ever touched the
+// other buffer.
+int snapshot_read(const snapshot_header *h, uint8_t *frame, int64_t *meta) {
+    uint64_t seq = __atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE);
+    if (seq == 0) return 0;
+    int front = seq & 1;
+    long size = (long)h->n * h->n;
+    const uint8_t *src = (const uint8_t *)(h + 1) + front * size;
+    for (long k = 0; k < size; ++k) frame[k] = src[k];
+    meta[0] = (int64_t)seq;
+    meta[1] = h->sweep[front];
+    meta[2] = h->E[front];
+    meta[3] = h->M[front];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&h->sequence, __ATOMIC_RELAXED) == seq;
+}
@@ -0,0 +1,45 @@
+#include <math.h>
+#include "ising.h"
+
+// Metropolis sweeps in a field h with M confined to the window [lo, hi]
+// and, when spring > 0, a harmonic bias spring/2 (M - M0)^2 (in units of kT).
+// Moves leaving the window cost one unsigned comparison each.
+void umbrella_run(ising_state *st, long long nsweeps, double h, int lo, int hi,
+                  double spring, double M0, observer *obs, int nobs) {
+    int N = st->N;
+    int *lattice = st->lattice;
+    // acc[s > 0][cost / 4 + 2] = exp(-beta (cost + 2 h s))
+    double acc[2][5];
+    for (int up = 0; up < 2; ++up) {
+        for (int c = 0; c < 5; ++c) {
+            double dE = 4 * (c - 2) + 2 * h * (up ? 1 : -1);
+            acc[up][c] = exp(-st->beta * dE);
+        }
+    }
+    unsigned long long range = (unsigned long long)(hi - lo);
+    for (long long t = 0; t < nsweeps; ++t) {
+        for (int k = 0; k < N*N; ++k) {
+            int i = rng_below(&st->rng, N);
+            int j = rng_below(&st->rng, N);
+            int idx = i * N + j;
+            int s = lattice[idx];
+            long long M = st->M - 2 * s;
+            if ((unsigned long long)(M - lo) > range) continue;
+            int sum = lattice[((i+1)%N)*N + j] + lattice[i*N + (j+1)%N]
+                    + lattice[((i-1+N)%N)*N + j] + lattice[i*N + ((j-1+N)%N)];
+            int cost = 2 * s * sum;
+            double p = acc[s > 0][cost / 4 + 2];
+            if (spring > 0) {
+                double before = st->M - M0, after = M - M0;
+                p *= exp(-0.5 * spring * (after * after - before * before));
+            }
+            if (p >= 1 || rng_uniform(&st->rng) < p) {
+                lattice[idx] = -s;
+                st->E += cost;
+                st->M = M;
+            }
+        }
+        st->sweep++;
+        if (nobs) run_observers(obs, nobs, st);
+    }
+}
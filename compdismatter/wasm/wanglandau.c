@@ -0,0 +1,80 @@
+#include <math.h>
+#include "ising.h"
+
+static inline int energy_bin(long long E, int N) {
+    return (int)((E + 2LL * N * N) / 4);
+}
+
+// Change in E from flipping site (i, j)
+static inline int flip_cost(const int *lattice, int N, int i, int j) {
+    int sum = lattice[((i+1)%N)*N + j] + lattice[i*N + (j+1)%N]
+            + lattice[((i-1+N)%N)*N + j] + lattice[i*N + ((j-1+N)%N)];
+    return 2 * lattice[i*N + j] * sum;
+}
+
+static inline int window_distance(int b, int lo, int hi) {
+    return b < lo ? lo - b : b > hi ? b - hi : 0;
+}
+
+// Wang-Landau walk restricted to the energy bins [lo, hi]. ln g is raised
+// by lnf and the histogram incremented after every attempt. A state that
+// starts outside the window first drifts into it: moves are accepted as
+// long as they do not take it further away, without touching lng or hist.
+void wang_landau_run(ising_state *st, long long nsweeps, double *lng, long long *hist,
+                     int lo, int hi, double lnf) {
+    int N = st->N;
+    int *lattice = st->lattice;
+    int b = energy_bin(st->E, N);
+    for (long long t = 0; t < nsweeps; ++t) {
+        for (int k = 0; k < N*N; ++k) {
+            int i = rng_below(&st->rng, N);
+            int j = rng_below(&st->rng, N);
+            int cost = flip_cost(lattice, N, i, j);
+            int nb = b + cost / 4;
+            int accept;
+            if (b < lo || b > hi) {
+                accept = window_distance(nb, lo, hi) <= window_distance(b, lo, hi);
+            } else {
+                accept = nb >= lo && nb <= hi
+                      && (lng[nb] <= lng[b] || rng_uniform(&st->rng) < exp(lng[b] - lng[nb]));
+            }
+            if (accept) {
+                int s = lattice[i*N + j];
+                lattice[i*N + j] = -s;
+                st->E += cost;
+                st->M -= 2 * s;
+                b = nb;
+            }
+            if (b >= lo && b <= hi) {
+                lng[b] += lnf;
+                hist[b]++;
+            }
+        }
+        st->sweep++;
+    }
+}
+
+// Multicanonical production with fixed weights exp(-ln g(E)); observers see
+// a flat energy histogram that is reweighted afterwards
+void muca_run(ising_state *st, long long nsweeps, const double *lng, observer *obs, int nobs) {
+    int N = st->N;
+    int *lattice = st->lattice;
+    int b = energy_bin(st->E, N);
+    for (long long t = 0; t < nsweeps; ++t) {
+        for (int k = 0; k < N*N; ++k) {
+            int i = rng_below(&st->rng, N);
+            int j = rng_below(&st->rng, N);
+            int cost = flip_cost(lattice, N, i, j);
+            int nb = b + cost / 4;
+            if (lng[nb] <= lng[b] || rng_uniform(&st->rng) < exp(lng[b] - lng[nb])) {
+                int s = lattice[i*N + j];
+                lattice[i*N + j] = -s;
+                st->E += cost;
+                st->M -= 2 * s;
+                b = nb;
+            }
+        }
+        st->sweep++;
+        if (nobs) run_observers(obs, nobs, st);
+    }
+}
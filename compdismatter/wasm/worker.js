@@ -0,0 +1,284 @@
+// Worker running the Ising kernels of ising.wasm off the main thread, as a
+// browser Web Worker or headless as a Node worker_threads worker.
+//
+// Messages to the worker:
+//   {type: 'init', wasm, N, temperature, seed, shared}
+//       wasm: the bytes of ising-shared.wasm or ising.wasm (ArrayBuffer or
+//       typed array) or its URL
+//       shared: whether to use shared memory (needs SharedArrayBuffer)
+//   {type: 'start', sweeps, batch, interval}
+//       run `sweeps` sweeps (Infinity: until stopped) in batches of `batch`,
+//       publishing a frame at most every `interval` milliseconds
+//   {type: 'stop'}                  stop after the current batch
+//   {type: 'set', temperature}      change the temperature between batches
+//   {type: 'frame'}                 publish the current lattice now
+//
+// Messages from the worker:
+//   {type: 'ready', N, buffer, frames, lattice}
+//       buffer: the SharedArrayBuffer holding the frames at byte offset
+//       frames, or null; lattice: byte offset of the live Int32 lattice in
+//       buffer when the kernels run in it, else null
+//   {type: 'frame', sequence, sweep, E, M, lattice}
+//       lattice is an Int8Array (transferred) only when there is no shared
+//       buffer; otherwise the frame is in shared memory
+//   {type: 'stopped', sweep, E, M}
+//   {type: 'error', message}
+//
+// ising-shared.wasm (built with shared memory) runs in a WebAssembly.Memory
+// backed by a SharedArrayBuffer, so the state and lattice the kernels update
+// are visible to the page as they are. ising.wasm cannot import shared
+// memory; it runs in private memory and only the frames are shared.
+//
+// Shared frames are double buffered like the native snapshot: an Int32
+// header [sequence, N], sweep, E and M of both frames as Float64 from byte
+// FRAME_META, and two N x N Int8Array frames from byte frameOffset(), all
+// relative to the frames offset. The lattice changes during every sweep, so
+// frames are what a reader can rely on to be whole: the worker fills frame
+// (sequence + 1) & 1 and then publishes it with Atomics.store; a reader
+// keeps its copy of frame sequence & 1 only if sequence is unchanged
+// afterwards (see client.js).
+
+const FRAME_META = 16;
+const frameOffset = () => FRAME_META + 6 * 8;
+const frameBytes = (N) => frameOffset() + 2 * N * N;
+
+// Layout of ising_state in wasm32: lattice pointer, N, beta, rng, sweep, E, M
+const STATE = {lattice: 0, N: 4, beta: 8, rng: 16, sweep: 24, E: 32, M: 40, size: 48};
+
+const isNode = typeof process !== 'undefined' && !!(process.versions && process.versions.node)
+    && typeof self === 'undefined';
+let post;
+
+function readLEB(bytes, pos) {
+    let result = 0, shift = 0, b;
+    do {
+        b = bytes[pos.i++];
+        result += (b & 0x7f) * 2 ** shift;
+        shift += 7;
+    } while (b & 0x80);
+    return result;
+}
+
+// Memory and table sizes a side module asks for, from its dylink.0 section
+function dylinkInfo(module) {
+    const info = {memorySize: 0, memoryAlign: 0, tableSize: 0};
+    const sections = WebAssembly.Module.customSections(module, 'dylink.0');
+    if (!sections.length) return info;
+    const bytes = new Uint8Array(sections[0]), pos = {i: 0};
+    while (pos.i < bytes.length) {
+        const type = bytes[pos.i++], size = readLEB(bytes, pos), end = pos.i + size;
+        if (type === 1) {
+            info.memorySize = readLEB(bytes, pos);
+            info.memoryAlign = readLEB(bytes, pos);
+            info.tableSize = readLEB(bytes, pos);
+        }
+        pos.i = end;
+    }
+    return info;
+}
+
+class Kernel {
+    // Instantiate the side module in a memory of its own: module data, a
+    // stack, the state, the lattice and then the frames. With shared, the
+    // memory is shared if the module can import it (a LinkError says not).
+    static async load(wasm, N, shared) {
+        if (typeof wasm === 'string') wasm = await (await fetch(wasm)).arrayBuffer();
+        const module = await WebAssembly.compile(wasm);
+        const info = dylinkInfo(module);
+        const memoryBase = 1024, stackSize = 1 << 16;
+        const stackTop = align(memoryBase + info.memorySize, 16) + stackSize;
+        const stateBase = align(stackTop, 16);
+        const latticeBase = stateBase + STATE.size;
+        const framesBase = align(latticeBase + 4 * N * N, 8);
+        const pages = Math.ceil((framesBase + frameBytes(N)) / 65536) + 1;
+        const layout = {memoryBase, stackTop, stateBase, latticeBase, framesBase, tableSize: info.tableSize};
+        if (shared) {
+            const memory = new WebAssembly.Memory({initial: pages, maximum: pages, shared: true});
+            try {
+                return await new Kernel(memory, N, layout).instantiate(module);
+            } catch (e) {
+                if (!(e instanceof WebAssembly.LinkError)) throw e;
+            }
+        }
+        return new Kernel(new WebAssembly.Memory({initial: pages}), N, layout).instantiate(module);
+    }
+
+    constructor(memory, N, layout) {
+        this.memory = memory;
+        this.N = N;
+        this.stateBase = layout.stateBase;
+        this.latticeBase = layout.latticeBase;
+        this.framesBase = layout.framesBase;
+        this.layout = layout;
+    }
+
+    async instantiate(module) {
+        const {memoryBase, stackTop, tableSize} = this.layout;
+        const table = new WebAssembly.Table({initial: tableSize, element: 'anyfunc'});
+        const env = {
+            memory: this.memory,
+            __indirect_function_table: table,
+            __memory_base: new WebAssembly.Global({value: 'i32', mutable: false}, memoryBase),
+            __table_base: new WebAssembly.Global({value: 'i32', mutable: false}, 0),
+            __stack_pointer: new WebAssembly.Global({value: 'i32', mutable: true}, stackTop),
+        };
+        const got = {};
+        for (const imp of WebAssembly.Module.imports(module)) {
+            if (imp.module === 'env' && !(imp.name in env)) env[imp.name] = this.libc(imp.name);
+            if (imp.module === 'GOT.mem' || imp.module === 'GOT.func') {
+                got[imp.name] = new WebAssembly.Global({value: 'i32', mutable: true}, 0);
+            }
+        }
+        const instance = await WebAssembly.instantiate(module, {env, 'GOT.mem': got, 'GOT.func': got});
+        const exports = instance.exports;
+        for (const [name, global] of Object.entries(got)) {
+            if (exports[name] instanceof WebAssembly.Global) global.value = memoryBase + exports[name].value;
+        }
+        if (exports.__wasm_apply_data_relocs) exports.__wasm_apply_data_relocs();
+        if (exports.__wasm_call_ctors) exports.__wasm_call_ctors();
+        if (!exports.metropolis_run || !exports.state_init) {
+            throw new Error('the module does not export metropolis_run and state_init; '
+                            + 'build ising-shared.wasm or ising.wasm with `make` (needs emcc)');
+        }
+        this.exports = exports;
+        return this;
+    }
+
+    get shared() {
+        return typeof SharedArrayBuffer !== 'undefined' && this.memory.buffer instanceof SharedArrayBuffer;
+    }
+
+    // The few libc functions the kernels import
+    libc(name) {
+        if (name === 'fabs') return Math.abs;
+        if (typeof Math[name] === 'function') return Math[name];
+        if (name === 'clock_gettime') {
+            return (clock, ts) => {
+                const t = performance.now(), view = new DataView(this.memory.buffer);
+                view.setBigInt64(ts, BigInt(Math.floor(t / 1000)), true);
+                view.setInt32(ts + 8, Math.floor((t % 1000) * 1e6), true);
+                return 0;
+            };
+        }
+        return () => { throw new Error(`${name} is not available in the worker`); };
+    }
+
+    get view() { return new DataView(this.memory.buffer); }
+    get lattice() { return new Int32Array(this.memory.buffer, this.latticeBase, this.N * this.N); }
+
+    reset(temperature, seed) {
+        const lattice = this.lattice, v = this.view, s = this.stateBase;
+        let rng = BigInt.asUintN(64, BigInt(seed));
+        for (let k = 0; k < lattice.length; ++k) {
+            rng = BigInt.asUintN(64, rng * 6364136223846793005n + 1442695040888963407n);
+            lattice[k] = rng >> 63n ? 1 : -1;
+        }
+        v.setInt32(s + STATE.lattice, this.latticeBase, true);
+        v.setInt32(s + STATE.N, this.N, true);
+        v.setFloat64(s + STATE.beta, 1 / temperature, true);
+        v.setBigUint64(s + STATE.rng, rng, true);
+        v.setBigInt64(s + STATE.sweep, 0n, true);
+        this.exports.state_init(s);
+    }
+
+    set temperature(T) { this.view.setFloat64(this.stateBase + STATE.beta, 1 / T, true); }
+
+    read(field) { return Number(this.view.getBigInt64(this.stateBase + STATE[field], true)); }
+
+    // long long arguments arrive as BigInt, or as two i32 halves when the
+    // module was built with legalised JS FFI
+    run(nsweeps) {
+        const f = this.exports.metropolis_run;
+        if (f.length === 5) f(this.stateBase, nsweeps, 0, 0, 0);
+        else f(this.stateBase, BigInt(nsweeps), 0, 0);
+    }
+}
+
+function align(x, a) { return Math.ceil(x / a) * a; }
+
+// frames: {buffer, base} of the shared frames, or null to send them by message
+let kernel = null, frames = null, running = false, stopRequested = false, lastFrame = -Infinity;
+
+function publish() {
+    const sweep = kernel.read('sweep'), E = kernel.read('E'), M = kernel.read('M');
+    const lattice = kernel.lattice;
+    if (frames) {
+        const {buffer, base} = frames;
+        const header = new Int32Array(buffer, base, 2);
+        const sequence = Atomics.load(header, 0) + 1, back = sequence & 1;
+        new Int8Array(buffer, base + frameOffset() + back * lattice.length, lattice.length).set(lattice);
+        new Float64Array(buffer, base + FRAME_META, 6).set([sweep, E, M], 3 * back);
+        Atomics.store(header, 0, sequence);
+        post({type: 'frame', sequence, sweep, E, M});
+    } else {
+        const frame = Int8Array.from(lattice);
+        post({type: 'frame', sweep, E, M, lattice: frame}, [frame.buffer]);
+    }
+    lastFrame = Date.now();
+}
+
+const yieldToMessages = () => new Promise((resolve) => setTimeout(resolve, 0));
+
+async function start({sweeps = Infinity, batch = 10, interval = 50}) {
+    if (running) return;
+    running = true;
+    stopRequested = false;
+    let done = 0;
+    while (done < sweeps && !stopRequested) {
+        const n = Math.min(batch, sweeps - done);
+        kernel.run(n);
+        done += n;
+        if (Date.now() - lastFrame >= interval) publish();
+        await yieldToMessages();
+    }
+    running = false;
+    publish();
+    post({type: 'stopped', sweep: kernel.read('sweep'), E: kernel.read('E'), M: kernel.read('M')});
+}
+
+async function handle(msg) {
+    try {
+        switch (msg.type) {
+        case 'init': {
+            const shared = !!msg.shared && typeof SharedArrayBuffer !== 'undefined';
+            kernel = await Kernel.load(msg.wasm, msg.N, shared);
+            if (kernel.shared) frames = {buffer: kernel.memory.buffer, base: kernel.framesBase};
+            else if (shared) frames = {buffer: new SharedArrayBuffer(frameBytes(msg.N)), base: 0};
+            else frames = null;
+            if (frames) new Int32Array(frames.buffer, frames.base, 2).set([0, msg.N]);
+            kernel.reset(msg.temperature ?? 2.269, msg.seed ?? Date.now());
+            post({type: 'ready', N: msg.N, buffer: frames && frames.buffer, frames: frames && frames.base,
+                  lattice: kernel.shared ? kernel.latticeBase : null});
+            break;
+        }
+        case 'start':
+            await start(msg);
+            break;
+        case 'stop':
+            stopRequested = true;
+            break;
+        case 'set':
+            if (msg.temperature !== undefined) kernel.temperature = msg.temperature;
+            break;
+        case 'frame':
+            publish();
+            break;
+        default:
+            throw new Error(`unknown message ${msg.type}`);
+        }
+    } catch (e) {
+        post({type: 'error', message: String(e && e.message || e)});
+    }
+}
+
+if (isNode) {
+    const {parentPort} = require('worker_threads');
+    if (parentPort) {
+        post = (m, transfer) => parentPort.postMessage(m, transfer);
+        parentPort.on('message', handle);
+    }
+    module.exports = {frameBytes, frameOffset, FRAME_META};
+} else {
+    post = (m, transfer) => self.postMessage(m, transfer || []);
+    self.onmessage = (e) => handle(e.data);
+}
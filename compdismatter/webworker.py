@@ -0,0 +1,79 @@
+"""
+Simulations in a Web Worker for the pyodide front-end.
+
+Under pyodide everything runs on the page's main thread, so calling the
+kernels directly freezes the page for the length of the run. Here the WASM
+kernels run in wasm/worker.js instead, driven through wasm/client.js (which
+the page must load, making `IsingWorker` global). Frames are read from
+shared memory on cross-origin isolated pages, otherwise from the last
+frame message.
+
+The kernels must come from an ising-shared.wasm (run in shared memory) or
+ising.wasm built by `make` with emcc; a module without metropolis_run and
+state_init (such as the ising.wasm placeholder in the source tree) is
+rejected when the worker starts, and `ready` fails.
+"""
+import numpy as np
+
+class WorkerSimulation:
+    def __init__(self, N, temperature, seed=None, worker_url='compdismatter/wasm/worker.js',
+                 wasm_url='compdismatter/wasm/ising-shared.wasm'):
+        """
+        Ising simulation in a Web Worker.
+
+        Parameters:
+        -----------
+        N : int
+            Size of the lattice (N x N)
+        temperature : float
+            Initial temperature
+        worker_url, wasm_url : str
+            Where the page serves worker.js and the kernels
+
+        Example usage:
+
+        sim = WorkerSimulation(N=512, temperature=2.0)
+        await sim.ready
+        sim.start(batch=5, interval=40)
+        sim.set_temperature(1.5)
+        config = sim.latest()
+        await sim.stop()
+        """
+        import js
+        from pyodide.ffi import to_js
+        self.N = N
+        self._to_js = lambda d: to_js(d, dict_converter=js.Object.fromEntries)
+        self.worker = js.IsingWorker.new(worker_url)
+        if seed is None:
+            seed = int(np.random.randint(2**31))
+        self.ready = self.worker.init(self._to_js({'wasm': wasm_url, 'N': N, 'temperature': temperature,
+                                                   'seed': seed}))
+
+    def start(self, sweeps=None, batch=10, interval=50):
+        """ Run sweeps (default: until stopped); returns a promise of the final sweep, E and M """
+        options = {'batch': batch, 'interval': interval}
+        if sweeps is not None:
+            options['sweeps'] = sweeps
+        return self.worker.start(self._to_js(options))
+
+    def stop(self):
+        return self.worker.stop()
+
+    def set_temperature(self, temperature):
+        self.worker.set(self._to_js({'temperature': temperature}))
+
+    def on_frame(self, callback):
+        """ Call callback(sweep, E, M) from the page's event loop whenever a frame is published """
+        from pyodide.ffi import create_proxy
+        self._callback = create_proxy(lambda msg: callback(msg.sweep, msg.E, msg.M))
+        self.worker.onframe = self._callback
+
+    def latest(self):
+        """ The most recent lattice (N x N int8), or None before the first frame """
+        frame = self.worker.latest()
+        if frame is None:
+            return None
+        return np.asarray(frame.lattice.to_py(), dtype=np.int8).reshape(self.N, self.N)
+
+    def terminate(self):
+        self.worker.terminate()
@@ -2,11 +2,14 @@ from setuptools import setup, Extension
 from setuptools.command.build_ext import build_ext
 import os
 import subprocess
+from glob import glob
+
+sources = sorted(glob("compdismatter/wasm/*.c"))
 
 class build_ext_custom(build_ext):
     def run(self):
         # Compile the .so file
-        subprocess.check_call(["emcc", "compdismatter/wasm/ising.c", "-s", "SIDE_MODULE=2", "-O3", "-o", "compdismatter/wasm/ising.wasm"])
+        subprocess.check_call(["emcc", *sources, "-s", "SIDE_MODULE=2", "-O3", "-o", "compdismatter/wasm/ising.wasm"])
         
         # Compile the shared object (.so) for native use
         # subprocess.check_call(["gcc", "-shared", "-o", "compdismatter/lib/ising.so", "compdismatter/wasm/ising.c"])
@@ -18,12 +21,13 @@ setup(
     name="compdismatter",
     version="0.1.0",
     packages=["compdismatter"],
-    ext_modules=[Extension("ising", sources=["compdismatter/wasm/ising.c"])],
+    ext_modules=[Extension("ising", sources=sources, depends=glob("compdismatter/wasm/*.h"))],
     cmdclass={"build_ext": build_ext_custom},
     include_package_data=True,
     package_data={
         'compdismatter': [
             'wasm/*.wasm',  # include the wasm file
+            'wasm/*.js',    # and the Web Worker that runs it
             'lib/*.so',     # include the .so file
         ],
     },
@@ -0,0 +1,30 @@
+# Exact enumeration of the 4 x 4 lattice, the reference of the sampler tests
+import numpy as np
+
+N = 4
+
+def enumerate_lattice():
+    """ E and M of all 2^16 configurations """
+    spins = ((np.arange(2**(N*N))[:, None] >> np.arange(N*N)) & 1) * 2 - 1
+    c = spins.reshape(-1, N, N)
+    E = -np.sum(c * (np.roll(c, 1, 1) + np.roll(c, 1, 2)), axis=(1, 2))
+    return E, c.sum(axis=(1, 2))
+
+def canonical(T):
+    """ Exact per-spin <e> and <|m|> at temperature T """
+    E, M = enumerate_lattice()
+    w = np.exp(-(E - E.min()) / T)
+    return np.sum(w * E) / w.sum() / (N*N), np.sum(w * np.abs(M)) / w.sum() / (N*N)
+
+def log_partition(T):
+    """ Exact ln Z at temperature T """
+    E, _ = enumerate_lattice()
+    return np.log(np.sum(np.exp(-(E - E.min()) / T))) - E.min() / T
+
+def free_energy_m(T):
+    """ M and the exact F(M) / kT, zero at its minimum """
+    E, M = enumerate_lattice()
+    levels = np.unique(M)
+    P = np.array([np.sum(np.exp(-(E[M == m] - E.min()) / T)) for m in levels])
+    F = -np.log(P)
+    return levels, F - F.min()
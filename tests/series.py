@@ -0,0 +1,23 @@
+# Shared fixture of the moment and resampling tests: E and M series of a
+# short native run near Tc, and the observables computed straight from them
+import numpy as np
+from compdismatter import core
+from compdismatter.stream import TimeSeries
+
+N, BETA = 8, 1/2.27
+
+def record(measure=()):
+    """ E and M (int64) of 5001 sweeps after 200 of equilibration, with any in-kernel measurements alongside """
+    config, seed = core.random_start(N, 3)
+    state = core.new_state(config, BETA, seed)
+    core.run(state, 200)
+    series = TimeSeries(5001)
+    core.run(state, 5001, list(measure) + [series])
+    return series.E[:len(series)].astype(np.int64), series.M[:len(series)].astype(np.int64)
+
+def direct(E, M):
+    """ e, |m|, c, chi and u4 straight from the series """
+    n = N*N
+    e, m = np.asarray(E, dtype=float) / n, np.abs(np.asarray(M, dtype=float)) / n
+    return {'e': e.mean(), 'm': m.mean(), 'c': BETA*BETA*n*e.var(), 'chi': BETA*n*m.var(),
+            'u4': 1 - np.mean(m**4) / (3*np.mean(m*m)**2)}
@@ -0,0 +1,33 @@
+# Backend registry and automatic selection:
+#     python -m unittest tests/test_backends.py
+import os
+import tempfile
+import unittest
+from compdismatter import backends
+
+class BackendTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        os.environ['COMPDISMATTER_CACHE'] = os.path.join(self.tmp.name, 'backends.json')
+        os.environ.pop('COMPDISMATTER_BACKEND', None)
+        backends._chosen.clear()
+
+    def tearDown(self):
+        backends.use(None)
+        backends._chosen.clear()
+        del os.environ['COMPDISMATTER_CACHE']
+        self.tmp.cleanup()
+
+    def test_select_only_seeded(self):
+        for N in (4, 32):
+            self.assertIn(backends.select(N).name, ('native', 'numpy'))
+
+    def test_forced(self):
+        for name in backends.available():
+            backends.use(name)
+            self.assertEqual(backends.select(16).name, name)
+        backends.use(None)
+        self.assertTrue(backends.select(16).automatic)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,35 @@
+# Campaigns: a failing job must not lose the rows of the others:
+#     python -m unittest tests/test_campaign.py
+import os
+import tempfile
+import unittest
+from unittest import mock
+from compdismatter import campaign
+from compdismatter.campaign import Campaign
+
+class CampaignTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.addCleanup(self.tmp.cleanup)
+
+    def grid(self):
+        return Campaign(sizes=[8], temperatures=[2.0, 2.3, 2.6], seeds=[0, 1], equilibration=20,
+                        production=50, path=os.path.join(self.tmp.name, 'fss.jsonl'), workers=2)
+
+    def test_failed_job(self):
+        run_job = campaign._run_job
+        def fails_at(root, N, T, seed, *args):
+            if (T, seed) == (2.3, 1):
+                raise ValueError("boom")
+            return run_job(root, N, T, seed, *args)
+        with mock.patch('compdismatter.campaign._run_job', fails_at):
+            with self.assertRaises(RuntimeError) as failure:
+                self.grid().run()
+        self.assertIn("1 of 6 jobs failed", str(failure.exception))
+        self.assertIn("N=8 T=2.3 seed=1: ValueError('boom')", str(failure.exception))
+        self.assertEqual(len(self.grid().table()), 5)
+        self.assertEqual(self.grid().pending(), [(8, 2.3, 1)])
+        self.assertEqual(len(self.grid().run()), 6)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,37 @@
+# The numpy checkerboard samples the same distribution as the native kernel:
+#     python -m unittest tests/test_checkerboard.py
+import unittest
+import numpy as np
+from compdismatter import backends
+from compdismatter.checkerboard import colouring
+from compdismatter.core import IsingModel
+
+class CheckerboardTest(unittest.TestCase):
+    def tearDown(self):
+        backends.use(None)
+
+    def test_colouring(self):
+        for N in (4, 5, 7, 8):
+            masks = colouring(N)
+            np.testing.assert_array_equal(sum(m.astype(int) for m in masks), 1)
+            for m in masks:
+                # no two neighbours in one colour class
+                self.assertFalse((m & np.roll(m, 1, 0)).any() or (m & np.roll(m, 1, 1)).any())
+
+    def test_against_native(self):
+        # even (two colours) and odd (three colours) lattices near Tc
+        for N in (6, 5):
+            runs = {}
+            for name in ('native', 'numpy'):
+                backends.use(name)
+                model = IsingModel(N, equilibration=500, production=20000)
+                model.simulate(2.5, seed=1)
+                self.assertEqual(model.backend, name)
+                runs[name] = model
+            native, numpy = runs['native'], runs['numpy']
+            for q in ('e', 'm'):
+                sigma = np.hypot(native.errors[q], numpy.errors[q])
+                self.assertLess(abs(native.results[q] - numpy.results[q]), 4*sigma, msg=f"N={N} {q}")
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,95 @@
+# Cluster labelling against a breadth-first search with periodic boundaries:
+#     python -m unittest tests/test_clusters.py
+from collections import deque
+import unittest
+import numpy as np
+from compdismatter.clusters import label_clusters
+
+def reference(c, spin):
+    """
+    Labels, sizes and wrapping flags (1 along rows, 2 along columns) by
+    breadth-first search. Sites are visited with unwrapped coordinates; a
+    cluster wraps when it reaches a site it already holds at an image
+    shifted by the lattice size.
+    """
+    N = c.shape[0]
+    labels = np.full((N, N), -1)
+    sizes, wraps = [], []
+    for i in range(N):
+        for j in range(N):
+            if labels[i, j] >= 0 or (spin and c[i, j] != spin):
+                continue
+            K = len(sizes)
+            unwrapped = {(i, j): (i, j)}
+            labels[i, j] = K
+            queue = deque([(i, j)])
+            w = 0
+            while queue:
+                a, b = queue.popleft()
+                ua, ub = unwrapped[a, b]
+                for da, db in ((1, 0), (-1, 0), (0, 1), (0, -1)):
+                    x, y = (a + da) % N, (b + db) % N
+                    if c[x, y] != c[i, j]:
+                        continue
+                    if (x, y) in unwrapped:
+                        px, py = unwrapped[x, y]
+                        w |= 2*(px != ua + da) | (py != ub + db)
+                    else:
+                        unwrapped[x, y] = (ua + da, ub + db)
+                        labels[x, y] = K
+                        queue.append((x, y))
+            sizes.append(len(unwrapped))
+            wraps.append(w)
+    return labels, np.array(sizes, dtype=int), np.array(wraps, dtype=int)
+
+class LabelTest(unittest.TestCase):
+    def check(self, c, spin):
+        result = label_clusters(c, spin)
+        labels, sizes, wraps = reference(c, spin)
+        self.assertEqual(len(result.sizes), len(sizes))
+        np.testing.assert_array_equal(result.labels < 0, labels < 0)
+        inside = labels >= 0
+        # the same partition: each reference cluster maps to one label and back
+        pairs = np.unique(np.stack([labels[inside], result.labels[inside]]), axis=1)
+        self.assertEqual(pairs.shape[1], len(sizes))
+        ref, got = pairs
+        np.testing.assert_array_equal(result.sizes[got], sizes[ref])
+        np.testing.assert_array_equal(result.wraps_x[got] + 2*result.wraps_y[got], wraps[ref])
+        return result
+
+    def test_random(self):
+        rng = np.random.default_rng(1)
+        for N in (1, 2, 3, 7, 33, 65, 130):
+            for p in (0.3, 0.6, 0.8):
+                c = np.where(rng.random((N, N)) < p, 1, -1).astype(np.int32)
+                for spin in (1, -1, 0):
+                    with self.subTest(N=N, p=p, spin=spin):
+                        self.check(c, spin)
+
+    def test_uniform(self):
+        for N in (1, 4, 70):
+            c = np.ones((N, N), dtype=np.int32)
+            r = self.check(c, 1)
+            self.assertTrue(r.spanning)
+            self.assertEqual(len(self.check(c, -1).sizes), 0)
+
+    def test_checkerboard_domains(self):
+        # N^2 single-site domains, more than one spin's capacity
+        N = 8
+        c = np.where(np.add.outer(np.arange(N), np.arange(N)) % 2, 1, -1).astype(np.int32)
+        r = self.check(c, 0)
+        self.assertEqual(len(r.sizes), N*N)
+
+    def test_threads(self):
+        rng = np.random.default_rng(2)
+        c = np.where(rng.random((150, 150)) < 0.59, 1, -1).astype(np.int32)
+        one = label_clusters(c, 1, threads=1)
+        for threads in (2, 3, 8, 200):
+            r = label_clusters(c, 1, threads=threads)
+            np.testing.assert_array_equal(r.labels, one.labels)
+            np.testing.assert_array_equal(r.sizes, one.sizes)
+            np.testing.assert_array_equal(r.wraps_x, one.wraps_x)
+            np.testing.assert_array_equal(r.wraps_y, one.wraps_y)
+
+if __name__ == '__main__':
+    unittest.main()
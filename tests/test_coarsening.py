@@ -0,0 +1,47 @@
+# Coarsening tracker: rows against numpy on the final configuration, and
+# Onsager's energy at known points:
+#     python -m unittest tests/test_coarsening.py
+import unittest
+import numpy as np
+from compdismatter.coarsening import Coarsening, COLUMNS, log_schedule, onsager_energy
+
+def spectrum_moments(config):
+    """ First two moments of S(k) over the shells 0 < |n| <= N/2, on the full plane """
+    N = config.shape[0]
+    S = np.abs(np.fft.fft2(config))**2 / config.size
+    n = np.fft.fftfreq(N, 1.0/N)
+    shell = np.rint(np.hypot(n[:, None], n[None, :])).astype(int)
+    keep = (shell > 0) & (shell <= N//2)
+    k = 2*np.pi*shell[keep] / N
+    w = S[keep]
+    return np.sum(w*k) / w.sum(), np.sum(w*k*k) / w.sum()
+
+class CoarseningTest(unittest.TestCase):
+    def test_onsager(self):
+        Tc = 2/np.log(1 + np.sqrt(2))
+        self.assertAlmostEqual(onsager_energy(Tc), -np.sqrt(2), places=12)
+        self.assertAlmostEqual(onsager_energy(0.1), -2.0, places=12)
+        # low-temperature expansion -2 + 8 x^4 + 24 x^6 (x = e^-2/T, per spin)
+        x = np.exp(-2/1.0)
+        self.assertAlmostEqual(onsager_energy(1.0), -2 + 8*x**4 + 24*x**6, delta=1e-4)
+
+    def test_quench(self):
+        N = 64
+        tracker = Coarsening(N, log_schedule(1000, 10)).quench(1.5, seed=1)
+        self.assertEqual(len(tracker['sweep']), len(tracker.schedule))
+        last = dict(zip(COLUMNS, tracker.table[-1]))
+        n = N*N
+        self.assertEqual(last['sweep'], tracker.state.sweep)
+        self.assertEqual(last['e'], tracker.state.E / n)
+        self.assertEqual(last['m'], tracker.state.M / n)
+        self.assertAlmostEqual(last['L_energy'], 4 / (last['e'] - onsager_energy(1.5)), places=10)
+        k1, k2 = spectrum_moments(tracker.config)
+        self.assertAlmostEqual(last['k1'], k1, places=8)
+        self.assertAlmostEqual(last['k2'], k2, places=8)
+        self.assertAlmostEqual(last['L_k'], 2*np.pi / k1, places=6)
+        # domains grow
+        L = tracker['L_energy']
+        self.assertGreater(L[-1], 4*L[0])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,33 @@
+# Forward flux sampling: the cluster order parameter, and a nucleation rate
+# that does not depend on where the intermediate interfaces are placed:
+#     python -m unittest tests/test_ffs.py
+import unittest
+import numpy as np
+from compdismatter.clusters import label_clusters
+from compdismatter.ffs import ForwardFluxSampling, largest_cluster
+
+class FFSTest(unittest.TestCase):
+    def test_largest_cluster(self):
+        rng = np.random.default_rng(0)
+        for N, p in ((8, 0.3), (16, 0.5), (33, 0.6)):
+            c = np.where(rng.random((N, N)) < p, 1, -1).astype(np.int32)
+            for spin in (1, -1):
+                self.assertEqual(largest_cluster(c, spin), label_clusters(c, spin).sizes.max())
+
+    def test_rate_independent_of_interfaces(self):
+        rates = []
+        for interfaces in ([3, 8, 40], [3, 8, 16, 40], [3, 8, 12, 20, 40]):
+            ffs = ForwardFluxSampling(16, 1.5, 0.4, interfaces, trials=1000, maxsweeps=2000, seed=5)
+            ffs.flux(2000)
+            rate, error = ffs.run()
+            self.assertEqual(len(ffs.probabilities), len(interfaces) - 2)
+            rates.append((rate, error))
+        for rate, error in rates[1:]:
+            self.assertLess(abs(rate - rates[0][0]), 3*np.hypot(error, rates[0][1]))
+
+    def test_run_needs_flux(self):
+        with self.assertRaises(RuntimeError):
+            ForwardFluxSampling(16, 1.5, 0.4, [3, 8, 40]).run()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,32 @@
+# Kinetically constrained models: the dynamics keep the equilibrium density
+# of excitations, and the East model relaxes slower than FA:
+#     python -m unittest tests/test_kcm.py
+import unittest
+import numpy as np
+from compdismatter.kcm import KineticallyConstrainedModel, dynamic_heterogeneity
+
+class KCMTest(unittest.TestCase):
+    def test_dynamics(self):
+        times = np.logspace(0, 3, 7)
+        persistence = {}
+        for model in ('fa', 'east'):
+            kcm = KineticallyConstrainedModel(64, 0.5, model, seed=1)
+            results = kcm.run(times)
+            self.assertEqual(kcm.time, times[-1])
+            self.assertAlmostEqual(results['density'].mean(), kcm.c, delta=0.01)
+            self.assertEqual(results['density'][-1], kcm.config.mean())
+            self.assertEqual(results['persistence'][-1], kcm.persistent.mean())
+            self.assertTrue(np.all(np.diff(results['persistence']) <= 0))
+            persistence[model] = results['persistence']
+        self.assertTrue(np.all(persistence['east'][2:5] > persistence['fa'][2:5] + 0.1))
+
+    def test_heterogeneity(self):
+        times = np.logspace(0, 3, 7)
+        results = dynamic_heterogeneity(16, 0.5, times, samples=8)
+        self.assertEqual(results['persistence'].shape, times.shape)
+        self.assertTrue(np.all(results['chi4'] >= 0))
+        # chi4 peaks while the sites relax, not at the ends
+        self.assertTrue(0 < np.argmax(results['chi4']) < len(times) - 1)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,23 @@
+# In-kernel moments against numpy on the series of the same run:
+#     python -m unittest tests/test_moments.py
+import unittest
+import numpy as np
+from compdismatter.moments import Moments, QUANTITIES
+from .series import N, BETA, record, direct
+
+class MomentsTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.moments = Moments(N, blocks=16)
+        cls.E, cls.M = record([cls.moments])
+
+    def test_in_kernel(self):
+        values, errors = self.moments.results()
+        ref = direct(self.E, self.M)
+        ref_errors = Moments.from_series(self.E, self.M, N, BETA, blocks=16).results()[1]
+        for q in QUANTITIES:
+            self.assertAlmostEqual(values[q], ref[q], delta=1e-10*abs(ref[q]), msg=q)
+            self.assertAlmostEqual(errors[q], ref_errors[q], delta=1e-8*ref_errors[q], msg=q)
+
+if __name__ == '__main__':
+    unittest.main()
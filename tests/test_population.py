@@ -0,0 +1,21 @@
+# Population annealing against exact enumeration of 4 x 4:
+#     python -m unittest tests/test_population.py
+import unittest
+import numpy as np
+from compdismatter.population import PopulationAnnealing
+from .exact import N, canonical, log_partition
+
+class PopulationTest(unittest.TestCase):
+    def test_anneal(self):
+        T = 2.5
+        pa = PopulationAnnealing(N, R=2000, sweeps=5)
+        results = pa.run(np.linspace(5.0, T, 20))
+        e, m = canonical(T)
+        self.assertAlmostEqual(results['e'][-1], e, delta=0.03)
+        self.assertAlmostEqual(results['m'][-1], m, delta=0.03)
+        # the free energy from the resampling weights alone
+        self.assertAlmostEqual(results['f'][-1], -T*log_partition(T) / (N*N), delta=0.01)
+        self.assertTrue(1 <= results['rho'][-1] < pa.R)
+
+if __name__ == '__main__':
+    unittest.main()
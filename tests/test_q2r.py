@@ -0,0 +1,40 @@
+# Bit-packed lattices and the Q2R automaton against plain numpy:
+#     python -m unittest tests/test_q2r.py
+import unittest
+import numpy as np
+from compdismatter import bitpack
+from compdismatter.q2r import Q2R
+
+def energy(c):
+    return -int(np.sum(c * (np.roll(c, 1, 0) + np.roll(c, 1, 1))))
+
+class BitpackTest(unittest.TestCase):
+    def test_round_trip(self):
+        rng = np.random.default_rng(0)
+        # partial words, exactly one word, and rows spanning several
+        for N in (5, 63, 64, 70, 130):
+            c = np.where(rng.random((N, N)) < 0.5, 1, -1).astype(np.int32)
+            packed = bitpack.pack(c)
+            self.assertEqual(packed.shape, (N, bitpack.words(N)))
+            np.testing.assert_array_equal(bitpack.unpack(packed, N), c)
+            self.assertEqual(bitpack.energy(packed, N), energy(c))
+            self.assertEqual(bitpack.magnetisation(packed, N), c.sum())
+
+class Q2RTest(unittest.TestCase):
+    def test_conserves_energy(self):
+        rng = np.random.default_rng(1)
+        for N in (8, 66):
+            c = np.where(rng.random((N, N)) < 0.3, 1, -1).astype(np.int32)
+            q2r = Q2R(c)
+            energies = q2r.run(200)
+            np.testing.assert_array_equal(energies, energy(c))
+            self.assertEqual(energy(q2r.config), energy(c))
+            self.assertFalse(np.array_equal(q2r.config, c))
+            self.assertEqual(q2r.magnetisation, q2r.config.sum())
+
+    def test_odd_size(self):
+        with self.assertRaises(ValueError):
+            Q2R(np.ones((7, 7), dtype=np.int32))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,37 @@
+# Path-integral Monte Carlo of the transverse-field Ising model against exact
+# diagonalisation of 3 x 3:
+#     python -m unittest tests/test_quantum.py
+import unittest
+import numpy as np
+from compdismatter.quantum import TransverseFieldIsing
+
+N, T, GAMMA = 3, 1.0, 2.0
+
+def exact():
+    """ Thermal e, mx and |mz| per site from the full 512 x 512 Hamiltonian """
+    n = N*N
+    spins = ((np.arange(2**n)[:, None] >> np.arange(n)) & 1) * 2 - 1
+    c = spins.reshape(-1, N, N)
+    Ez = -np.sum(c * (np.roll(c, 1, 1) + np.roll(c, 1, 2)), axis=(1, 2)).astype(float)
+    H = np.diag(Ez)
+    for i in range(n):
+        H[np.arange(2**n), np.arange(2**n) ^ (1 << i)] -= GAMMA
+    w, v = np.linalg.eigh(H)
+    p = np.exp(-(w - w.min()) / T)
+    rho = (v * (p / p.sum())) @ v.T
+    diagonal = np.diag(rho)
+    E = np.trace(rho @ H)
+    return {'e': E / n, 'mx': -(E - diagonal @ Ez) / (GAMMA*n),
+            'mz': diagonal @ np.abs(c.sum(axis=(1, 2))) / n}
+
+class QuantumTest(unittest.TestCase):
+    def test_against_exact(self):
+        reference = exact()
+        for algorithm in ('wolff', 'sw'):
+            model = TransverseFieldIsing(N, P=64, field=GAMMA, algorithm=algorithm, seed=2)
+            results = model.simulate(T, equilibration=500, production=5000)
+            for q in ('e', 'mx', 'mz'):
+                self.assertAlmostEqual(results[q], reference[q], delta=0.03, msg=f"{algorithm} {q}")
+
+if __name__ == '__main__':
+    unittest.main()
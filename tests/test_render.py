@@ -0,0 +1,90 @@
+# PNG and animated PNG encoding, decoded back with zlib:
+#     python -m unittest tests/test_render.py
+import os
+import struct
+import tempfile
+import unittest
+import zlib
+import numpy as np
+from compdismatter.core import IsingModel
+from compdismatter.render import png, palette, render, Movie
+
+def chunks(data):
+    """ (type, body) of every chunk, checking the signature and CRCs """
+    assert data[:8] == b'\x89PNG\r\n\x1a\n'
+    pos, out = 8, []
+    while pos < len(data):
+        n, = struct.unpack('>I', data[pos:pos + 4])
+        kind, body = data[pos + 4:pos + 8], data[pos + 8:pos + 8 + n]
+        crc, = struct.unpack('>I', data[pos + 8 + n:pos + 12 + n])
+        assert crc == zlib.crc32(kind + body), kind
+        out.append((kind, body))
+        pos += 12 + n
+    return out
+
+def pixels(body, n):
+    raw = np.frombuffer(zlib.decompress(body), np.uint8).reshape(n, n + 1)
+    assert not raw[:, 0].any()    # filter type none on every row
+    return raw[:, 1:]
+
+class PNGTest(unittest.TestCase):
+    def test_round_trip(self):
+        rng = np.random.default_rng(0)
+        for N, b in ((5, 1), (64, 1), (64, 4), (300, 3), (256, 16)):
+            c = np.where(rng.random((N, N)) < 0.5, 1, -1).astype(np.int32)
+            parts = chunks(png(c, b))
+            kinds = [k for k, _ in parts]
+            self.assertEqual(kinds[0], b'IHDR')
+            self.assertEqual(kinds[-1], b'IEND')
+            n = N // b
+            self.assertEqual(struct.unpack('>II', parts[0][1][:8]), (n, n))
+            plte = dict(parts)[b'PLTE']
+            self.assertEqual(plte, palette(b).tobytes())
+            img = pixels(b''.join(body for k, body in parts if k == b'IDAT'), n)
+            # palette index of the block magnetisation, rounded
+            B = c.reshape(n, b, n, b).sum(axis=(1, 3))
+            ncolors = min(b*b + 1, 256)
+            np.testing.assert_array_equal(img, ((B + b*b)*(ncolors - 1) + b*b) // (2*b*b))
+
+    def test_large_blocks(self):
+        # 2 b^2 (ncolors - 1) overflows int arithmetic for b = 4096
+        N = 4096
+        c = np.ones((N, N), dtype=np.int32)
+        c[:N//4] = -1       # m = 1/2: index (1.5 * 255 + 1) // 2
+        colors = palette(N)
+        np.testing.assert_array_equal(render(c, N), colors[[[191]]])
+
+    @unittest.skipUnless(os.path.exists('/dev/full'), "needs /dev/full")
+    def test_write_error(self):
+        movie = Movie('/dev/full', 16, frames=2)
+        with self.assertRaises(OSError):
+            movie.close()
+
+    def test_movie(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, 'movie.png')
+            model = IsingModel(32, equilibration=0, production=20)
+            with Movie(path, 32, frames=5, every=2, block=2) as movie:
+                model.simulate(1.5, measure=[movie])
+            self.assertEqual(movie.frames, 5)
+            with open(path, 'rb') as f:
+                parts = chunks(f.read())
+            self.assertEqual(struct.unpack('>I', dict(parts)[b'acTL'][:4])[0], 5)
+            self.assertEqual(sum(k == b'fcTL' for k, _ in parts), 5)
+            self.assertEqual(sum(k == b'IDAT' for k, _ in parts), 1)
+            for k, body in parts:
+                if k == b'fdAT':
+                    self.assertEqual(pixels(body[4:], 16).shape, (16, 16))
+
+    def test_empty_movie(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, 'empty.png')
+            movie = Movie(path, 16, frames=3)
+            self.assertEqual(movie.close(), 0)
+            with open(path, 'rb') as f:
+                parts = chunks(f.read())
+            self.assertEqual(struct.unpack('>I', dict(parts)[b'acTL'][:4])[0], 1)
+            self.assertFalse(pixels(dict(parts)[b'IDAT'], 16).any())
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,59 @@
+# The native jackknife and bootstrap against numpy:
+#     python -m unittest tests/test_resample.py
+import unittest
+import numpy as np
+from compdismatter.moments import QUANTITIES
+from compdismatter.resample import Series, jackknife, bootstrap, bootstrap_means
+from .series import N, BETA, record, direct
+
+def jackknife_reference(E, M, blocks):
+    """ Values and errors of the delete-one-block jackknife, all in numpy """
+    size = -(-len(E) // blocks)
+    starts = range(0, len(E), size)
+    loo = [direct(np.delete(E, slice(s, s + size)), np.delete(M, slice(s, s + size))) for s in starts]
+    B = len(loo)
+    errors = {}
+    for q in QUANTITIES:
+        x = np.array([r[q] for r in loo])
+        errors[q] = np.sqrt((B - 1) / B * np.sum((x - x.mean())**2))
+    return direct(E, M), errors
+
+class ResampleTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.E, cls.M = record()
+
+    def test_jackknife(self):
+        for blocks in (2, 7, 64):
+            jk = jackknife(Series(self.E, self.M, N, BETA), blocks=blocks, threads=3)
+            values, errors = jackknife_reference(self.E, self.M, blocks)
+            for q in QUANTITIES:
+                self.assertAlmostEqual(jk.values[q], values[q], delta=1e-10*abs(values[q]), msg=(blocks, q))
+                self.assertAlmostEqual(jk.errors[q], errors[q], delta=1e-7*errors[q], msg=(blocks, q))
+
+    def test_blocks_independent_of_threads(self):
+        series = Series(self.E, self.M, N, BETA)
+        one = series.blocks(37, threads=1)
+        for threads in (2, 5, 64):
+            np.testing.assert_array_equal(series.blocks(37, threads)[0], one[0])
+            np.testing.assert_array_equal(series.blocks(37, threads)[1], one[1])
+
+    def test_bootstrap(self):
+        series = Series(self.E, self.M, N, BETA)
+        one = bootstrap(series, ['c', 'u4'], blocks=32, samples=50, threads=1)
+        for threads in (3, 100):
+            b = bootstrap(series, ['c', 'u4'], blocks=32, samples=50, threads=threads)
+            np.testing.assert_array_equal(b.replicates, one.replicates)
+        # replicates are weighted means of whole blocks, so within their range
+        sums, weights = series.blocks(4)
+        means = bootstrap_means(sums, weights, 20)
+        block_means = sums / weights[:, None]
+        self.assertTrue(np.all(means >= block_means.min(axis=0) - 1e-12))
+        self.assertTrue(np.all(means <= block_means.max(axis=0) + 1e-12))
+        single = bootstrap_means(sums[:1], weights[:1], 3, threads=8)
+        np.testing.assert_allclose(single, np.repeat(sums[:1] / weights[0], 3, axis=0))
+        with self.assertRaises(ValueError):
+            bootstrap_means(sums, weights, 0)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,62 @@
+# On-disk result cache: resuming runs, and surviving a crash while storing:
+#     python -m unittest tests/test_results.py
+import json
+import os
+import tempfile
+import unittest
+from unittest import mock
+import numpy as np
+from compdismatter import backends
+from compdismatter.core import IsingModel
+from compdismatter.results import ResultCache
+
+class ResultCacheTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def cache(self, name):
+        return ResultCache(os.path.join(self.tmp.name, name), chunk=64)
+
+    def test_resume_matches_one_run(self):
+        whole = self.cache('whole').run(8, 2.3, 50, 300, seed=2)
+        cache = self.cache('parts')
+        cache.run(8, 2.3, 50, 100, seed=2)
+        parts = cache.run(8, 2.3, 50, 300, seed=2)
+        for name in ('sweep', 'E', 'M'):
+            np.testing.assert_array_equal(parts.column(name), whole.column(name))
+        np.testing.assert_array_equal(parts.config, whole.config)
+        self.assertEqual([f for f in os.listdir(parts.path) if f.endswith('.npy')], ['config-300.npy'])
+
+    def test_observables_match_simulate(self):
+        result = self.cache('obs').run(8, 2.3, 50, 300, seed=2)
+        model = IsingModel(8, equilibration=50, production=300)
+        backends.use('native')     # the kernel the cache runs on
+        self.addCleanup(backends.use, None)
+        model.simulate(2.3, seed=2)
+        values, errors = result.observables()
+        for q in model.results:
+            self.assertAlmostEqual(values[q], model.results[q], places=12)
+            self.assertAlmostEqual(errors[q], model.errors[q], places=12)
+        self.assertAlmostEqual(result.meta['summary']['errors']['u4'], model.errors['u4'], places=12)
+
+    def test_crash_before_meta(self):
+        whole = self.cache('whole').run(8, 2.3, 50, 300, seed=2)
+        cache = self.cache('crash')
+        cache.run(8, 2.3, 50, 100, seed=2)
+        # die after the configuration is written but before meta.json is replaced
+        with mock.patch('compdismatter.results.json.dump', side_effect=KeyboardInterrupt):
+            with self.assertRaises(KeyboardInterrupt):
+                cache.run(8, 2.3, 50, 200, seed=2)
+        stored = cache.get(8, 2.3, 50, seed=2)
+        self.assertEqual(stored.length, 100)
+        resumed = cache.run(8, 2.3, 50, 300, seed=2)
+        np.testing.assert_array_equal(resumed.column('E'), whole.column('E'))
+        np.testing.assert_array_equal(resumed.config, whole.config)
+        with open(os.path.join(resumed.path, 'meta.json')) as f:
+            self.assertEqual(json.load(f)['config'], 'config-300.npy')
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,60 @@
+# Histogram reweighting against exact enumeration, and combining replica
+# histograms before reweighting:
+#     python -m unittest tests/test_reweighting.py
+import unittest
+import numpy as np
+from compdismatter.core import IsingModel
+from compdismatter.reweighting import EnergyHistogram, MagnetisationHistogram, combine, multi_histogram
+from .exact import N, canonical
+
+class ReweightTest(unittest.TestCase):
+    def test_against_exact(self):
+        hists = []
+        for T in (2.2, 2.5, 2.8):
+            hists.append(EnergyHistogram(N))
+            IsingModel(N, equilibration=200, production=40000).simulate(T, measure=hists[-1:], seed=1)
+        temperatures = [2.35, 2.5, 2.65]
+        single = hists[1].reweight(temperatures)
+        multi = multi_histogram(hists, temperatures)
+        for k, T in enumerate(temperatures):
+            e, m = canonical(T)
+            for curves in (single, multi):
+                self.assertAlmostEqual(curves['e'][k], e, delta=0.02, msg=T)
+                self.assertAlmostEqual(curves['m'][k], m, delta=0.02, msg=T)
+
+class CombineTest(unittest.TestCase):
+    def replicas(self, Histogram, N=8, T=2.4):
+        hists = [Histogram(N) for _ in range(2)]
+        for seed, h in enumerate(hists):
+            IsingModel(N, equilibration=50, production=300).simulate(T, measure=[h], seed=seed)
+        return hists
+
+    def test_counts_add(self):
+        for Histogram in (EnergyHistogram, MagnetisationHistogram):
+            a, b = self.replicas(Histogram)
+            total = combine([a, b])
+            np.testing.assert_array_equal(total.counts, a.counts + b.counts)
+            self.assertEqual(total.counts.sum(), 600)
+            self.assertEqual(total.beta, a.beta)
+            x, p = total.distribution()
+            self.assertAlmostEqual(p.sum(), 1.0, places=12)
+            self.assertTrue(np.all(np.abs(x) <= 2))
+
+    def test_moments_add(self):
+        a, b = self.replicas(EnergyHistogram)
+        total = combine([a, b])
+        for name in ('m1', 'm2', 'm4'):
+            np.testing.assert_allclose(getattr(total, name), getattr(a, name) + getattr(b, name))
+
+    def test_mismatch(self):
+        a = self.replicas(EnergyHistogram)[0]
+        b = self.replicas(EnergyHistogram, T=2.0)[0]
+        with self.assertRaises(ValueError):
+            combine([a, b])
+
+    def test_empty(self):
+        with self.assertRaises(ValueError):
+            combine([])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,52 @@
+# Block spins against numpy majority rule, and MCRG exponents at Tc:
+#     python -m unittest tests/test_rg.py
+import unittest
+import numpy as np
+from compdismatter import bitpack
+from compdismatter.core import IsingModel
+from compdismatter.rg import MCRG, block_spin, block_spin_packed, downsample
+
+def majority(config, b):
+    """ Block sums; ties go to the top-left spin of the block """
+    N = config.shape[0] // b
+    sums = config.reshape(N, b, N, b).sum(axis=(1, 3))
+    return np.where(sums != 0, np.sign(sums), config[::b, ::b]).astype(np.int32)
+
+class BlockSpinTest(unittest.TestCase):
+    def test_majority(self):
+        rng = np.random.default_rng(0)
+        for N, b, levels in ((27, 3, 2), (64, 2, 3), (128, 4, 1), (192, 64, 1)):
+            c = np.where(rng.random((N, N)) < 0.5, 1, -1).astype(np.int32)
+            expected = c
+            for _ in range(levels):
+                expected = majority(expected, b)
+            np.testing.assert_array_equal(block_spin(c, b, levels), expected)
+            packed = block_spin_packed(bitpack.pack(c), N, b, levels)
+            np.testing.assert_array_equal(bitpack.unpack(packed, N // b**levels), expected)
+
+    def test_random_ties(self):
+        c = np.ones((8, 8), dtype=np.int32)
+        c[:, ::2] = -1      # every 2 x 2 block is a tie
+        blocked = block_spin(c, 2, seed=1)
+        self.assertEqual(set(np.unique(blocked)), {-1, 1})
+        np.testing.assert_array_equal(blocked, block_spin(c, 2, seed=1))
+        self.assertTrue((block_spin(c, 2) == -1).all())
+
+    def test_checks(self):
+        with self.assertRaises(ValueError):
+            block_spin(np.ones((10, 10), dtype=np.int32), 2, 2)
+        self.assertEqual(downsample(np.ones((64, 64), dtype=np.int32), 16).shape, (16, 16))
+
+class MCRGTest(unittest.TestCase):
+    def test_exponents(self):
+        # y_t = 1 and y_h = 15/8 for the 2D Ising model
+        rg = MCRG(64, b=2, levels=3, every=2)
+        IsingModel(64, equilibration=1000, production=10000).simulate(2/np.log(1 + np.sqrt(2)),
+                                                                     measure=[rg], seed=1)
+        self.assertEqual(rg.samples, 5000)
+        yt, yh = rg.exponents()
+        np.testing.assert_allclose(yt[1:], 1.0, atol=0.1)
+        np.testing.assert_allclose(yh[1:], 15/8, atol=0.1)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,40 @@
+# Live snapshots in shared memory, read in this and in another process:
+#     python -m unittest tests/test_snapshot.py
+import subprocess
+import sys
+import unittest
+from compdismatter.core import IsingModel
+from compdismatter.snapshot import SharedSnapshot, SnapshotReader
+
+class SnapshotTest(unittest.TestCase):
+    def setUp(self):
+        self.live = SharedSnapshot(64, block=2, interval=0)
+        self.model = IsingModel(64, equilibration=0, production=20)
+        self.model.simulate(2.0, measure=[self.live])
+
+    def tearDown(self):
+        self.live.close()
+
+    def test_latest(self):
+        reader = SnapshotReader(self.live.name)
+        sweep, E, M, frame = reader.latest()
+        self.assertEqual((sweep, E, M), (self.model.state.sweep, self.model.state.E, self.model.state.M))
+        self.assertEqual(frame.shape, (32, 32))
+        self.assertFalse(reader.updated())
+        reader.close()
+
+    def test_reader_process(self):
+        # a reader exiting must not remove (or warn about) the writer's block
+        code = (f"from compdismatter.snapshot import SnapshotReader\n"
+                f"r = SnapshotReader({self.live.name!r})\n"
+                f"print(r.latest()[0])\n"
+                f"r.close()\n")
+        child = subprocess.run([sys.executable, '-c', code], capture_output=True, text=True, check=True)
+        self.assertEqual(child.stdout.split()[-1], str(self.model.state.sweep))
+        self.assertNotIn('leaked', child.stderr)
+        reader = SnapshotReader(self.live.name)
+        self.assertEqual(reader.latest()[0], self.model.state.sweep)
+        reader.close()
+
+if __name__ == '__main__':
+    unittest.main()
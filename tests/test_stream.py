@@ -0,0 +1,103 @@
+# Background simulations: cancelling while the batch queue is full must end
+# the run and deliver the end marker, never leave a thread blocked:
+#     python -m unittest tests/test_stream.py
+import asyncio
+import threading
+import time
+import unittest
+import numpy as np
+from compdismatter.core import IsingModel
+from compdismatter.stream import Simulation
+
+def start(production=10**6, N=16):
+    return Simulation(np.ones((N, N), dtype=np.int32), 2.0, 0, production, batch=10, maxsize=1, seed=1)
+
+class StreamTest(unittest.TestCase):
+    def finishes(self, target, timeout=5):
+        t = threading.Thread(target=target, daemon=True)
+        t.start()
+        t.join(timeout)
+        self.assertFalse(t.is_alive(), "timed out")
+
+    def test_iterate(self):
+        sim = start(production=95)
+        blocks = list(sim)
+        self.assertEqual(sum(len(b['sweep']) for b in blocks), 95)
+        self.assertEqual(blocks[-1]['sweep'][-1], 95)
+        self.assertEqual(list(sim), [])
+
+    def test_seed(self):
+        model = IsingModel(16, equilibration=50, production=200)
+        def series(seed):
+            return np.concatenate([b['e'] for b in model.start(2.3, batch=50, seed=seed)])
+        np.testing.assert_array_equal(series(4), series(4))
+        self.assertFalse(np.array_equal(series(4), series(5)))
+
+    def test_cancel_while_full(self):
+        for wait in (0.0, 0.02, 0.05):
+            sim = start()
+            time.sleep(wait)    # the producer fills the queue and waits for room
+            sim.cancel()
+            self.finishes(sim.join)
+            self.assertTrue(sim.done())
+
+    def test_cancel_while_ending(self):
+        # the only batch fills the queue, so the end marker waits for room
+        sim = start(production=10)
+        time.sleep(0.05)
+        sim.cancel()
+        time.sleep(0.3)     # until the run has given up waiting
+        self.finishes(lambda: list(sim))
+        self.finishes(sim.join)
+
+    def test_cancel_after_partial_read(self):
+        sim = start()
+        next(sim)
+        time.sleep(0.02)
+        sim.cancel()
+        self.finishes(lambda: list(sim))
+        self.finishes(sim.join)
+
+    def test_async_task_cancelled(self):
+        async def main():
+            sim = start()
+            async def consume():
+                async for _ in sim:
+                    await asyncio.sleep(0.001)
+            task = asyncio.create_task(consume())
+            await asyncio.sleep(0.05)
+            task.cancel()
+            with self.assertRaises(asyncio.CancelledError):
+                await task
+            sim.cancel()
+            async for _ in sim:
+                pass
+            return sim
+        sim = asyncio.run(asyncio.wait_for(main(), 5))
+        sim._thread.join(5)
+        self.assertTrue(sim.done())
+
+    def test_async_cancel_loses_nothing(self):
+        # a slow producer keeps the consumer waiting on an empty queue, where
+        # the task is cancelled; no batch may go missing afterwards
+        production = 400
+        async def main():
+            sim = start(production, N=256)
+            received = []
+            async def consume():
+                async for block in sim:
+                    received.append(block)
+            for _ in range(3):
+                task = asyncio.create_task(consume())
+                await asyncio.sleep(0.03)
+                task.cancel()
+                with self.assertRaises(asyncio.CancelledError):
+                    await task
+            await consume()
+            return received
+        received = asyncio.run(asyncio.wait_for(main(), 30))
+        sweeps = np.concatenate([b['sweep'] for b in received])
+        np.testing.assert_array_equal(sweeps, np.arange(1, production + 1))
+
+if __name__ == '__main__':
+    unittest.main()
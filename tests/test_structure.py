@@ -0,0 +1,35 @@
+# Native structure factor and correlation function against numpy's FFT:
+#     python -m unittest tests/test_structure.py
+import unittest
+import numpy as np
+from compdismatter.structure import StructureFactor
+
+class StructureFactorTest(unittest.TestCase):
+    def lattice(self, N, seed):
+        rng = np.random.default_rng(seed)
+        return np.where(rng.random((N, N)) < 0.6, 1, -1).astype(np.int32)
+
+    def test_power_matches_numpy(self):
+        for N in (2, 4, 16, 64):
+            sf = StructureFactor(N)
+            self.assertTrue(sf.plan.native)
+            configs = [self.lattice(N, seed) for seed in range(3)]
+            for c in configs:
+                sf.add(c)
+            ref = np.mean([np.abs(np.fft.rfft2(c))**2 for c in configs], axis=0) / (N*N)
+            np.testing.assert_allclose(sf.mean(), ref, rtol=1e-10, atol=1e-9, err_msg=f"N = {N}")
+
+    def test_correlation_matches_numpy(self):
+        for N in (4, 32):
+            c = self.lattice(N, N)
+            sf = StructureFactor(N)
+            sf.add(c)
+            fallback = StructureFactor(N)
+            fallback.plan.native = False
+            fallback.add(c)
+            np.testing.assert_allclose(sf.correlation(), fallback.correlation(), atol=1e-10)
+            np.testing.assert_allclose(sf.radial(), fallback.radial(), rtol=1e-10)
+            self.assertAlmostEqual(sf.correlation()[0], 1.0)
+
+if __name__ == '__main__':
+    unittest.main()
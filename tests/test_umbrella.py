@@ -0,0 +1,22 @@
+# Umbrella sampling of F(M) against exact enumeration of 4 x 4:
+#     python -m unittest tests/test_umbrella.py
+import unittest
+import numpy as np
+from compdismatter.umbrella import UmbrellaSampling
+from .exact import N, free_energy_m
+
+class UmbrellaTest(unittest.TestCase):
+    def test_free_energy(self):
+        T = 2.5
+        exact_M, exact_F = free_energy_m(T)
+        # hard windows, then with a spring towards their centres
+        for spring in (0.0, 0.05):
+            us = UmbrellaSampling(N, T, [(-16, -4), (-8, 8), (4, 16)], spring=spring, threads=3)
+            M, F = us.run(20000)
+            np.testing.assert_array_equal(M, exact_M)
+            # F is only known up to a constant
+            diff = F - exact_F
+            np.testing.assert_allclose(diff - diff.mean(), 0, atol=0.15, err_msg=f"spring {spring}")
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,34 @@
+# Wang-Landau and multicanonical sampling against exact enumeration of 4 x 4:
+#     python -m unittest tests/test_wanglandau.py
+import unittest
+import numpy as np
+from compdismatter.wanglandau import WangLandau
+from .exact import N, enumerate_lattice, canonical
+
+T = 2.5
+
+class WangLandauTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.levels, cls.g = np.unique(enumerate_lattice()[0], return_counts=True)
+        cls.e, cls.m = canonical(T)
+
+    def test_density_of_states(self):
+        for windows in (1, 2):
+            wl = WangLandau(N, windows=windows, lnf_final=1e-6, seed=3)
+            E, lng = wl.run()
+            np.testing.assert_array_equal(E, self.levels)
+            # normalised to the 2^16 states
+            lng += np.log(2**(N*N)) - np.log(np.sum(np.exp(lng)))
+            np.testing.assert_allclose(lng, np.log(self.g), atol=0.3, err_msg=f"{windows} windows")
+
+    def test_production(self):
+        wl = WangLandau(N, lnf_final=1e-6, seed=3)
+        hist = wl.production(20000)
+        self.assertEqual(hist.counts.sum(), 20000)
+        curves = wl.canonical([T])
+        self.assertAlmostEqual(curves['e'][0], self.e, delta=0.02)
+        self.assertAlmostEqual(curves['m'][0], self.m, delta=0.02)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,97 @@
+// Headless test of wasm/worker.js and wasm/client.js under Node worker_threads:
+//     node tests/test_worker.js
+//
+// ising.wasm needs emcc, so the worker is driven by a stand-in side module
+// with the same ABI: state_init(state) and metropolis_run(state, nsweeps,
+// observers, nobs), which only advances state->sweep and sets M = sweep.
+const assert = require('assert');
+const path = require('path');
+const {IsingWorker} = require(path.join(__dirname, '..', 'compdismatter', 'wasm', 'client.js'));
+
+const WORKER = path.join(__dirname, '..', 'compdismatter', 'wasm', 'worker.js');
+const STUB = Buffer.from(
+    '0061736d01000000010c0260017f0060047f7e7f7f00020f0103656e76066d656d6f72790200010303020001071f02' +
+    '0a73746174655f696e697400000e6d6574726f706f6c69735f72756e00010a25020900200042073703200b19002000' +
+    '200029031820017c370318200020002903183703280b', 'hex');
+// The same importing shared memory (limits 0x03: shared, up to 65536 pages),
+// as ising-shared.wasm does
+const SHARED_STUB = Buffer.from(STUB.toString('hex').replace(
+    '020f0103656e76066d656d6f7279020001', '02120103656e76066d656d6f7279020301808004'), 'hex');
+
+async function shared() {
+    const sim = new IsingWorker(WORKER);
+    let frames = 0;
+    sim.onframe = () => frames++;
+    await sim.init({wasm: STUB, N: 64, temperature: 2, seed: 5});
+    const running = sim.start({batch: 3, interval: 0});
+    // frames read while the worker keeps publishing must be whole
+    const deadline = Date.now() + 200;
+    let reads = 0;
+    while (Date.now() < deadline) {
+        const f = sim.latest();
+        if (f) {
+            assert.strictEqual(f.M, f.sweep);
+            assert.strictEqual(f.lattice.length, 64 * 64);
+            reads++;
+        }
+        await new Promise(r => setImmediate(r));
+    }
+    sim.set({temperature: 1.5});
+    const stopped = await sim.stop();
+    assert.strictEqual(await running, stopped);
+    assert.ok(reads > 0 && frames > 0);
+    const finite = await sim.start({sweeps: 30, batch: 10});
+    assert.strictEqual(finite.sweep, stopped.sweep + 30);
+    await sim.terminate();
+}
+
+async function sharedMemory() {
+    // kernels in shared memory: the live lattice is a view, frames still whole
+    const sim = new IsingWorker(WORKER);
+    await sim.init({wasm: SHARED_STUB, N: 16, seed: 3});
+    const live = sim.live();
+    assert.ok(live && live.buffer === sim.shared);
+    assert.strictEqual(live.length, 16 * 16);
+    assert.ok(live.every((s) => s === 1 || s === -1));
+    await sim.start({sweeps: 6, batch: 3});
+    const f = sim.latest();
+    assert.strictEqual(f.sweep, 6);
+    assert.deepStrictEqual(Array.from(f.lattice), Array.from(live));
+    await sim.terminate();
+
+    // a module without shared memory falls back to private memory
+    const plain = new IsingWorker(WORKER);
+    await plain.init({wasm: STUB, N: 16});
+    assert.strictEqual(plain.live(), null);
+    assert.ok(plain.shared);
+    await plain.terminate();
+}
+
+async function messages() {
+    const sim = new IsingWorker(WORKER);
+    await sim.init({wasm: STUB, N: 8, shared: false});
+    await sim.start({sweeps: 4, batch: 2});
+    const f = sim.latest();
+    assert.strictEqual(f.sweep, 4);
+    assert.strictEqual(f.lattice.length, 64);
+    await sim.terminate();
+}
+
+async function missingExports() {
+    // a module without the run loop (like an ising.wasm built before it) must fail loudly
+    const empty = Buffer.from('0061736d01000000', 'hex');
+    const sim = new IsingWorker(WORKER);
+    await assert.rejects(sim.init({wasm: empty, N: 4}), /metropolis_run/);
+    await sim.terminate();
+}
+
+(async () => {
+    for (const test of [shared, sharedMemory, messages, missingExports]) {
+        await test();
+        console.log('ok', test.name);
+    }
+    process.exit(0);
+})().catch(e => {
+    console.error(e);
+    process.exit(1);
+});